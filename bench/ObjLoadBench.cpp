@@ -0,0 +1,139 @@
+/**
+ * Compares the memory mapped, chunk parallel OBJ parser (parseObjFile) against
+ * the previous getline + istringstream + sscanf loader (kept below as legacyLoad).
+ *
+ * Without a file argument a grid mesh of 'faces' triangles is written to the
+ * temp directory first. Each loader runs 'runs' times, the best time counts,
+ * so both read the file from the page cache.
+ *
+ * Usage: ObjLoadBench [file.obj | faces] [runs]
+ */
+#include "../src/IO/ObjParser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    void legacyLoad(const std::string& fileName, ObjMesh& out)
+    {
+        std::ifstream inputFile(fileName);
+        std::string line;
+        while (std::getline(inputFile, line)) {
+            std::istringstream iss(line);
+            std::string word;
+            iss >> word;
+
+            if (word == "v") {
+                float x, y, z;
+                iss >> x >> y >> z;
+                out.vertices.emplace_back(x, y, z);
+            }
+            if (word == "f") {
+                int v, vt, vn;
+                int verticesIndices[3], normalIndices[3], textureIndices[3];
+                for (int i = 0; i < 3; i++) {
+                    iss >> word;
+                    if (sscanf(word.c_str(), "%d/%d/%d", &v, &vt, &vn) >= 1) {
+                        verticesIndices[i] = v - 1;
+                        normalIndices[i] = vn - 1;
+                        textureIndices[i] = vt - 1;
+                    }
+                }
+                out.faces.emplace_back(verticesIndices, normalIndices, textureIndices);
+            }
+            if (word == "vn") {
+                float x, y, z;
+                iss >> x >> y >> z;
+                out.normals.emplace_back(x, y, z);
+            }
+            if (word == "vt") {
+                float x, y;
+                iss >> x >> y;
+                out.textures.emplace_back(x, y);
+            }
+        }
+    }
+
+    // A height field grid with per-vertex uv and normal, two triangles per cell.
+    void writeGrid(const std::string& path, const int faces)
+    {
+        const int side = std::max(2, static_cast<int>(std::sqrt(faces / 2.0)) + 1);
+        std::ofstream obj(path);
+        obj << "# " << side << "x" << side << " grid\n";
+        for (int y = 0; y < side; ++y) {
+            for (int x = 0; x < side; ++x) {
+                const float u = static_cast<float>(x) / (side - 1);
+                const float v = static_cast<float>(y) / (side - 1);
+                obj << "v " << u * 2.0f - 1.0f << " " << 0.1f * std::sin(u * 20.0f) << " " << v * 2.0f - 1.0f << "\n";
+                obj << "vt " << u << " " << v << "\n";
+                obj << "vn 0 1 0\n";
+            }
+        }
+        for (int y = 0; y + 1 < side; ++y) {
+            for (int x = 0; x + 1 < side; ++x) {
+                const int a = y * side + x + 1, b = a + 1, c = a + side, d = c + 1;
+                obj << "f " << a << "/" << a << "/" << a << " " << c << "/" << c << "/" << c << " "
+                    << b << "/" << b << "/" << b << "\n";
+                obj << "f " << b << "/" << b << "/" << b << " " << c << "/" << c << "/" << c << " "
+                    << d << "/" << d << "/" << d << "\n";
+            }
+        }
+    }
+
+    template <typename Load>
+    double bestMillis(const int runs, const Load& load, ObjMesh& mesh)
+    {
+        double best = 1e30;
+        for (int i = 0; i < runs; ++i) {
+            mesh = ObjMesh();
+            const auto start = Clock::now();
+            load(mesh);
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    std::string path = argc > 1 ? argv[1] : "";
+    const int runs = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+
+    bool generated = false;
+    if (path.empty() || !std::filesystem::exists(path)) {
+        const int faces = path.empty() ? 2000000 : std::atoi(path.c_str());
+        path = (std::filesystem::temp_directory_path() / "ObjLoadBench.obj").string();
+        std::printf("writing %d face grid to %s\n", faces, path.c_str());
+        writeGrid(path, faces);
+        generated = true;
+    }
+
+    const double megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1 << 20);
+
+    ObjMesh legacy, parsed;
+    const double legacyMs = bestMillis(runs, [&](ObjMesh& mesh) { legacyLoad(path, mesh); }, legacy);
+    const double parsedMs = bestMillis(runs, [&](ObjMesh& mesh) { parseObjFile(path, mesh); }, parsed);
+
+    std::printf("%.1f MB, %zu vertices, %zu faces\n", megabytes, parsed.vertices.size(), parsed.faces.size());
+    std::printf("%-8s %10s %10s\n", "loader", "ms", "MB/s");
+    std::printf("%-8s %10.1f %10.1f\n", "legacy", legacyMs, megabytes / legacyMs * 1000.0);
+    std::printf("%-8s %10.1f %10.1f\n", "mmap", parsedMs, megabytes / parsedMs * 1000.0);
+    std::printf("speedup  %9.1fx\n", legacyMs / parsedMs);
+
+    if (legacy.vertices.size() != parsed.vertices.size() || legacy.faces.size() != parsed.faces.size()) {
+        std::printf("MISMATCH - the loaders disagree on the element counts\n");
+        return 1;
+    }
+
+    if (generated) std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,174 @@
+/**
+ * Compares the memory mapped TGA decoder (read_tga_file with vflip) against the
+ * previous path (kept below as legacyLoad): an ifstream read with byte at a time
+ * RLE decoding, the origin flip, then the extra flip_vertically ModelResource did.
+ *
+ * Textures of size x size pixels are written to the temp directory first, RLE and
+ * raw, RGB and RGBA. Each decode runs 'runs' times, the best time counts, so both
+ * read the files from the page cache. The last rows load three RLE maps in turn
+ * and side by side, as ModelResource does.
+ *
+ * Usage: TgaLoadBench [size] [runs]
+ */
+#include "../src/IO/tgaimage.h"
+#include "../src/Utils/TaskGroup.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct LegacyImage {
+        int w = 0, h = 0, bpp = 0;
+        std::vector<std::uint8_t> data;
+    };
+
+    void flipRows(LegacyImage& image)
+    {
+        const size_t rowBytes = static_cast<size_t>(image.w) * image.bpp;
+        for (int row = 0; row < image.h / 2; ++row) {
+            std::swap_ranges(image.data.begin() + row * rowBytes, image.data.begin() + (row + 1) * rowBytes,
+                             image.data.begin() + (image.h - 1 - row) * rowBytes);
+        }
+    }
+
+    bool legacyLoad(const std::string& path, LegacyImage& image)
+    {
+        std::ifstream in(path, std::ios::binary);
+        TGAHeader header;
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!in.good()) return false;
+
+        image.w = header.width;
+        image.h = header.height;
+        image.bpp = header.bitsperpixel >> 3;
+        const size_t pixelCount = static_cast<size_t>(image.w) * image.h;
+        image.data.assign(pixelCount * image.bpp, 0);
+
+        if (header.datatypecode == 2 || header.datatypecode == 3) {
+            in.read(reinterpret_cast<char*>(image.data.data()), static_cast<std::streamsize>(image.data.size()));
+            if (!in.good()) return false;
+        } else {
+            size_t currentPixel = 0, currentByte = 0;
+            std::uint8_t color[4];
+            while (currentPixel < pixelCount) {
+                std::uint8_t chunkHeader = in.get();
+                if (!in.good()) return false;
+                if (chunkHeader < 128) {
+                    chunkHeader++;
+                    for (int i = 0; i < chunkHeader; ++i) {
+                        in.read(reinterpret_cast<char*>(color), image.bpp);
+                        for (int t = 0; t < image.bpp; ++t) image.data[currentByte++] = color[t];
+                        if (++currentPixel > pixelCount) return false;
+                    }
+                } else {
+                    chunkHeader -= 127;
+                    in.read(reinterpret_cast<char*>(color), image.bpp);
+                    for (int i = 0; i < chunkHeader; ++i) {
+                        for (int t = 0; t < image.bpp; ++t) image.data[currentByte++] = color[t];
+                        if (++currentPixel > pixelCount) return false;
+                    }
+                }
+            }
+        }
+
+        if (!(header.imagedescriptor & 0x20)) flipRows(image);
+        flipRows(image);
+        return true;
+    }
+
+    // Blocks of flat color with noisy rows in between, so the RLE file has both runs and raw packets.
+    TGAImage makeTexture(const int size, const int bpp, const int seed)
+    {
+        TGAImage image(size, size, bpp);
+        std::uint8_t* data = image.buffer();
+        unsigned state = 12345u + seed;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                std::uint8_t* pixel = data + (static_cast<size_t>(y) * size + x) * bpp;
+                for (int c = 0; c < bpp; ++c) {
+                    if (y % 16 < 12) {
+                        pixel[c] = static_cast<std::uint8_t>((x / 24 * 37 + y / 16 * 11 + c * 50 + seed) & 0xff);
+                    } else {
+                        state = state * 1664525u + 1013904223u;
+                        pixel[c] = static_cast<std::uint8_t>(state >> 24);
+                    }
+                }
+            }
+        }
+        return image;
+    }
+
+    template <typename Load>
+    double bestMillis(const int runs, const Load& load)
+    {
+        double best = 1e30;
+        for (int i = 0; i < runs; ++i) {
+            const auto start = Clock::now();
+            load();
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    const int size = argc > 1 ? std::max(16, std::atoi(argv[1])) : 4096;
+    const int runs = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+    const auto dir = std::filesystem::temp_directory_path();
+
+    struct Case { const char* name; int bpp; bool rle; };
+    constexpr Case CASES[] = { { "rgb rle", 3, true }, { "rgba rle", 4, true }, { "rgb raw", 3, false }, { "rgba raw", 4, false } };
+
+    std::printf("%dx%d textures\n", size, size);
+    std::printf("%-10s %8s %10s %10s %8s\n", "format", "MB", "legacy ms", "mmap ms", "speedup");
+
+    bool mismatch = false;
+    std::vector<std::string> written, rleMaps;
+    for (const Case& c : CASES) {
+        const std::string path = (dir / (std::string("TgaLoadBench_") + std::to_string(c.bpp) + (c.rle ? "_rle" : "_raw") + ".tga")).string();
+        makeTexture(size, c.bpp, c.bpp).write_tga_file(path, true, c.rle);
+        written.push_back(path);
+        if (c.rle) rleMaps.push_back(path);
+
+        LegacyImage legacy;
+        TGAImage decoded;
+        const double legacyMs = bestMillis(runs, [&] { legacyLoad(path, legacy); });
+        const double decodedMs = bestMillis(runs, [&] { decoded = TGAImage(); decoded.read_tga_file(path, true); });
+
+        const double megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1 << 20);
+        std::printf("%-10s %8.1f %10.1f %10.1f %7.1fx\n", c.name, megabytes, legacyMs, decodedMs, legacyMs / decodedMs);
+
+        if (legacy.data.size() != static_cast<size_t>(decoded.width()) * decoded.height() * c.bpp ||
+            std::memcmp(legacy.data.data(), decoded.buffer(), legacy.data.size()) != 0) {
+            std::printf("MISMATCH - the decoders disagree on %s\n", c.name);
+            mismatch = true;
+        }
+    }
+
+    // Three maps, as the diffuse, normal and specular map of one resource.
+    rleMaps.push_back(rleMaps.front());
+    TGAImage maps[3];
+    const double serialMs = bestMillis(runs, [&] {
+        for (int i = 0; i < 3; ++i) maps[i].read_tga_file(rleMaps[i], true);
+    });
+    const double concurrentMs = bestMillis(runs, [&] {
+        TaskGroup group;
+        for (int i = 0; i < 3; ++i) group.run([&maps, &rleMaps, i] { maps[i].read_tga_file(rleMaps[i], true); });
+        group.wait();
+    });
+    std::printf("3 maps     %8s %10.1f %10.1f %7.1fx  (in turn / side by side, %zu workers)\n", "", serialMs,
+                concurrentMs, serialMs / concurrentMs, ThreadPool::instance().size());
+
+    for (const auto& path : written) std::filesystem::remove(path);
+    return mismatch ? 1 : 0;
+}
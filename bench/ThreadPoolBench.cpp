@@ -0,0 +1,179 @@
+/**
+ * Compares the work-stealing ThreadPool against the previous single
+ * mutex + std::queue<std::function> pool (kept below as LegacyThreadPool).
+ *
+ *  - throughput: many tiny tasks enqueued from the main thread.
+ *  - fan-out:    a few tasks that each enqueue many children from a worker
+ *                (the pattern nested parallel loops produce).
+ *  - latency:    enqueue -> start delay of a single task on an idle pool.
+ *
+ * Usage: ThreadPoolBench [tasks]
+ */
+#include "../src/Utils/ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    class LegacyThreadPool {
+    public:
+        explicit LegacyThreadPool(const size_t threads)
+        {
+            for (size_t i = 0; i < threads; i++) {
+                workers.emplace_back([this] {
+                    while (true) {
+                        std::function<void()> task;
+                        {
+                            std::unique_lock<std::mutex> lock(queueMutex);
+                            condition.wait(lock, [this] { return stop || !tasks.empty(); });
+                            if (stop && tasks.empty()) return;
+                            task = std::move(tasks.front());
+                            tasks.pop();
+                        }
+
+                        task();
+
+                        bool notify = false;
+                        {
+                            std::unique_lock<std::mutex> lock(queueMutex);
+                            if (--activeTasks == 0) notify = true;
+                        }
+                        if (notify) finishedCondition.notify_all();
+                    }
+                });
+            }
+        }
+
+        ~LegacyThreadPool()
+        {
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                stop = true;
+            }
+            condition.notify_all();
+            for (std::thread& worker : workers) worker.join();
+        }
+
+        void enqueue(std::function<void()> task)
+        {
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                tasks.push(std::move(task));
+                activeTasks.fetch_add(1, std::memory_order_relaxed);
+            }
+            condition.notify_one();
+        }
+
+        void waitFinished()
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            finishedCondition.wait(lock, [this] { return tasks.empty() && activeTasks == 0; });
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex queueMutex;
+        std::condition_variable condition;
+        std::condition_variable finishedCondition;
+        bool stop = false;
+        std::atomic<int> activeTasks = 0;
+    };
+
+    // Small fixed amount of arithmetic, roughly a few triangles worth of setup.
+    void spinWork(std::atomic<std::uint64_t>& sink)
+    {
+        std::uint64_t x = 0x12345678;
+        for (int i = 0; i < 64; i++) x = x * 6364136223846793005ull + 1442695040888963407ull;
+        sink.fetch_add(x & 1, std::memory_order_relaxed);
+    }
+
+    double millisSince(const Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    template <typename Pool>
+    double throughput(Pool& pool, const int tasks)
+    {
+        std::atomic<std::uint64_t> sink = 0;
+        const auto start = Clock::now();
+        for (int i = 0; i < tasks; i++) {
+            pool.enqueue([&sink] { spinWork(sink); });
+        }
+        pool.waitFinished();
+        return tasks / millisSince(start) / 1000.0;
+    }
+
+    template <typename Pool>
+    double fanOut(Pool& pool, const int tasks, const int parents)
+    {
+        std::atomic<std::uint64_t> sink = 0;
+        const int children = tasks / parents;
+        const auto start = Clock::now();
+        for (int p = 0; p < parents; p++) {
+            pool.enqueue([&pool, &sink, children] {
+                for (int c = 0; c < children; c++) {
+                    pool.enqueue([&sink] { spinWork(sink); });
+                }
+            });
+        }
+        pool.waitFinished();
+        return parents * children / millisSince(start) / 1000.0;
+    }
+
+    template <typename Pool>
+    double latencyMicros(Pool& pool, const int samples)
+    {
+        double total = 0.0;
+        for (int i = 0; i < samples; i++) {
+            // Let the workers go idle (and park) between samples.
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+            std::atomic<std::int64_t> started = 0;
+            const auto submitted = Clock::now();
+            pool.enqueue([&started] {
+                started.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+            });
+            pool.waitFinished();
+
+            const auto delay = Clock::time_point(Clock::duration(started.load())) - submitted;
+            total += std::chrono::duration<double, std::micro>(delay).count();
+        }
+        return total / samples;
+    }
+
+    template <typename Pool>
+    void runSuite(const char* name, const size_t threads, const int tasks)
+    {
+        Pool pool(threads);
+        throughput(pool, tasks / 10);  // warm-up
+
+        const double tp = throughput(pool, tasks);
+        const double fo = fanOut(pool, tasks, static_cast<int>(threads));
+        const double lat = latencyMicros(pool, 200);
+        std::printf("%-8s %7zu %16.2f %16.2f %14.1f\n", name, threads, tp, fo, lat);
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    const int tasks = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    std::printf("%-8s %7s %16s %16s %14s\n", "pool", "threads", "submit Mtask/s", "fan-out Mtask/s", "latency (us)");
+    for (const size_t threads : {1, 2, 4, 8, 16, 32, 64}) {
+        runSuite<LegacyThreadPool>("legacy", threads, tasks);
+        runSuite<ThreadPool>("stealing", threads, tasks);
+    }
+    return 0;
+}
@@ -4,9 +4,16 @@
 #include "../external/imgui/imgui_impl_glfw.h"
 #include "../external/imgui/imgui_impl_opengl3.h"
 
+#include <chrono>
 #include <filesystem>
+#include <optional>
 namespace fs = std::filesystem;
 
+// GL upload format matching the packed pixel layout, no swizzle on upload.
+static GLenum glFormatFor(const PixelFormat format) {
+    return format == PixelFormat::BGRA8 ? GL_BGRA : GL_RGBA;
+}
+
 bool Application::initWindow() {
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -124,18 +131,36 @@ void Application::buildScene() {
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // Linear filtering upscales the frame when dynamic resolution renders below window size.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 800, 800, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    textureWidth = width;
+    textureHeight = height;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureWidth, textureHeight, 0, glFormatFor(frames.colorFormat()),
+                 GL_UNSIGNED_BYTE, NULL);
 
     glUseProgram(shaderProgram);
     glUniform1i(glGetUniformLocation(shaderProgram, "screenTexture"), 0);
     ///
 
-    constexpr std::string floorRoot = "../Models/obj/";
-    const auto floorRes = std::make_shared<ModelResource>(floorRoot, "floor.obj", "floor_diffuse.tga",
-                                             "floor_nm_tangent.tga", "floor_spec.tga");
+    // Through the resource manager like every other model, so the floor's assets
+    // are counted in the budget and shared with the same files loaded later.
+    const std::string floorRoot = "../Models/obj/";
+    std::shared_ptr<const MeshCacheData> floorMesh;
+    std::shared_ptr<const TGAImage> floorMaps[3];
+    {
+        TaskGroup group;
+        group.run([&] { floorMesh = resources.loadMesh(floorRoot + "floor.obj"); });
+        group.run([&] { floorMaps[0] = resources.loadTexture(floorRoot + "floor_diffuse.tga"); });
+        group.run([&] { floorMaps[1] = resources.loadTexture(floorRoot + "floor_nm_tangent.tga"); });
+        group.run([&] { floorMaps[2] = resources.loadTexture(floorRoot + "floor_spec.tga"); });
+        group.wait();
+    }
+    const auto floorRes = std::make_shared<ModelResource>(floorMesh, floorMaps[0], floorMaps[1], floorMaps[2]);
+    resources.add(floorRoot + "floor.obj", floorRes);
     ModelInstance floorModel(floorRes, false);
 
     floorModel.scale = {5.0, 1.0, 5.0};
@@ -167,6 +192,7 @@ void Application::run() {
 
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
+        const auto inputTime = FrameRing::Clock::now();
 
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
@@ -198,8 +224,66 @@ void Application::run() {
         ImGui::Checkbox("Enable Shadows", &scene.useShadows);
         ImGui::Checkbox("Enable SSAO", &scene.useSSAO);
 
+        int framesInFlight = frames.getMaxFramesInFlight();
+        if (ImGui::SliderInt("Frames In Flight", &framesInFlight, 1, frames.size())) {
+            frames.setMaxFramesInFlight(framesInFlight);
+        }
+
+        bool pipelined = frames.getPipelineMode() == FrameRing::PipelineMode::Throughput;
+        if (ImGui::Checkbox("Pipelined Frames", &pipelined)) {
+            frames.setPipelineMode(pipelined ? FrameRing::PipelineMode::Throughput : FrameRing::PipelineMode::Latency);
+        }
+
+        ImGui::Checkbox("Dynamic Resolution", &resolutionScaler.enabled);
+        ImGui::SliderFloat("Frame Budget (ms)", &resolutionScaler.settings.targetFrameMs, 5.0f, 100.0f);
+        ImGui::Text("Render: %dx%d (%.0f%%), %.2f ms", textureWidth, textureHeight,
+                    resolutionScaler.scale() * 100.0f, resolutionScaler.averageFrameMs());
+        ImGui::Text("Input Latency: %.1f ms", inputLatencyMs);
+        ImGui::Text("Culled: %d / %d models (shadow: %d)", lastFrameStats.culledInstances,
+                    lastFrameStats.instances, lastFrameStats.shadowCulledInstances);
+        ImGui::Text("Culled Meshlets: %d / %d", lastFrameStats.culledMeshlets, lastFrameStats.meshlets);
+        ImGui::Checkbox("Occlusion Culling", &scene.useOcclusionCulling);
+        ImGui::Text("Occluded: %d models", lastFrameStats.occludedInstances);
+        ImGui::Checkbox("Level of Detail", &lodSelector.enabled);
+        ImGui::SliderInt("Face Budget", &lodSelector.settings.faceBudget, 10000, 2000000);
+        ImGui::Text("Faces: %d", lodSelector.selectedFaces());
+        if (lastPickedFace >= 0) ImGui::Text("Last Pick: face %d at %.2f", lastPickedFace, lastPickedDistance);
+
+        // Utilization over the last interval, per worker.
+        ThreadPool& pool = ThreadPool::instance();
+        if (glfwGetTime() - workerStatsTime >= WORKER_STATS_INTERVAL) {
+            workerStats = pool.workerStats();
+            pool.resetStats();
+            workerStatsTime = glfwGetTime();
+        }
+        if (ImGui::CollapsingHeader("Workers")) {
+            for (int i = 0; i < workerStats.size(); ++i) {
+                const auto& stats = workerStats[i];
+                const std::string overlay = std::to_string(static_cast<int>(stats.utilization * 100.0)) + "% | " +
+                                            std::to_string(stats.tasks) + " tasks, " +
+                                            std::to_string(stats.steals) + " steals";
+                ImGui::ProgressBar(static_cast<float>(stats.utilization), ImVec2(-1, 0), overlay.c_str());
+            }
+        }
+
+        // Every mesh and texture in memory, shared ones once.
+        if (ImGui::CollapsingHeader("Resources")) {
+            int budgetMb = static_cast<int>(resources.budget >> 20);
+            if (ImGui::SliderInt("Memory Budget (MB)", &budgetMb, 64, 8192)) {
+                resources.budget = static_cast<size_t>(budgetMb) << 20;
+            }
+            ImGui::Text("Resident: %.1f MB, %zu models", static_cast<double>(resources.residentBytes()) / (1 << 20),
+                        resources.resourceCount());
+            for (const auto& asset : resources.report()) {
+                ImGui::Text("%7.1f MB  %s %s (x%ld)", static_cast<double>(asset.bytes) / (1 << 20),
+                            asset.isTexture ? "tex " : "mesh", fs::path(asset.path).filename().string().c_str(),
+                            asset.references);
+            }
+        }
+
         ImGui::Separator();
         ImGui::Text("Models in Scene:");
+        if (resourceLoader.pending() > 0) ImGui::Text("Loading %d models...", resourceLoader.pending());
 
         for (int i = 0; i < scene.models.size(); ++i) {
             auto& model = scene.models[i];
@@ -326,7 +410,16 @@ void Application::run() {
         }
 
         cam.lookAt = cam.pos + forward;
-        Renderer::render(scene, rb);
+
+        // Finished loads replace their placeholders in this frame's snapshot.
+        swapInLoadedResources();
+
+        // Renders in the background, this frame presents the oldest finished one.
+        scene.updateBounds();
+        lodSelector.update(scene, resolutionScaler.scaledSize(height));
+        snapshots.publish(scene);
+        frames.submit(snapshots.latest(), resolutionScaler.scaledSize(width), resolutionScaler.scaledSize(height),
+                      inputTime);
 
         int fbWidth, fbHeight;
         glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
@@ -336,7 +429,24 @@ void Application::run() {
 
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, texture);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 800, 800, GL_RGB, GL_UNSIGNED_BYTE, rb.colorBuffer.data());
+        std::optional<FrameRing::Clock::time_point> presentedInputTime;
+        if (const RenderBuffers* frame = frames.acquireReady()) {
+            resolutionScaler.update(frame->stats.renderMs);
+            presentedInputTime = frame->stats.inputTime;
+            lastFrameStats = frame->stats;
+
+            // The quad covers the window, a smaller frame is upscaled by the sampler.
+            if (frame->width != textureWidth || frame->height != textureHeight) {
+                textureWidth = frame->width;
+                textureHeight = frame->height;
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureWidth, textureHeight, 0,
+                             glFormatFor(frame->colorFormat), GL_UNSIGNED_BYTE, frame->colorBuffer.data());
+            } else {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, glFormatFor(frame->colorFormat),
+                                GL_UNSIGNED_BYTE, frame->colorBuffer.data());
+            }
+            frames.release(frame);
+        }
 
         glUseProgram(shaderProgram);
         glBindVertexArray(VAO);
@@ -346,6 +456,13 @@ void Application::run() {
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
         glfwSwapBuffers(window);
+
+        // Input-to-display latency: from polling the input a frame shows until it is on screen.
+        if (presentedInputTime) {
+            const std::chrono::duration<float, std::milli> latency = FrameRing::Clock::now() - *presentedInputTime;
+            inputLatencyMs = inputLatencyMs == 0.0f ? latency.count()
+                                                    : inputLatencyMs + LATENCY_SMOOTHING * (latency.count() - inputLatencyMs);
+        }
     }
 
     ImGui_ImplOpenGL3_Shutdown();
@@ -406,29 +523,18 @@ void Application::mouse_button_callback(GLFWwindow* window, int button, int acti
         glfwGetCursorPos(window, &xPos, &yPos);
         Vec3f ray = app->screenToWorldRay(xPos, yPos);
 
-        float minT = std::numeric_limits<float>::max();
-        int closestModelIndex = -1;
-        for (int i = 0 ; i < app->scene.models.size(); ++i) {
-            const auto& model = app->scene.models[i];
-            const auto bbox = model.getWorldAABB();
+        Scene& scene = app->scene;
+        scene.updateBounds();
 
-            if (model.isDeletable == false) continue;
-            const float t =
-                ModelInstance::RayBoxInterSection(app->scene.getActiveCamera().pos, ray, bbox.min, bbox.max);
-
-            if (t >= 0 && t < minT) {
-                minT = t;
-                closestModelIndex = i;
-            }
-        }
+        const RayHit hit = scene.raycast(scene.getActiveCamera().pos, ray,
+            [&scene](const int i) { return scene.models[i].isDeletable; });
+        const int closestModelIndex = hit.instance;
 
         if (closestModelIndex != -1) {
-            std::cout << "Removing model at index: " << closestModelIndex << std::endl;
+            app->lastPickedFace = hit.face.face;
+            app->lastPickedDistance = hit.face.t;
             app->scene.models.erase(app->scene.models.begin() + closestModelIndex);
         }
-
-        std::cout << closestModelIndex << std::endl;
-        std::cout << ray.x() << " " << ray.y() << " " << ray.z() << std::endl;
     }
 }
 
@@ -457,14 +563,38 @@ Vec3f Application::screenToWorldRay(const double mouseX, const double mouseY) {
 void Application::addModelToScene(const std::string& folderPath, const std::string& objFile,
                                   const std::string& diffFile, const std::string& nmFile,
                                   const std::string& specFile) {
-    const std::string resourceKey = folderPath + objFile;
-    if (resourceCache.find(resourceKey) == resourceCache.end()) {
-        resourceCache[resourceKey] = std::make_shared<ModelResource>(
-            folderPath, objFile, diffFile, nmFile, specFile
-        );
+    if (auto resource = resources.find(folderPath + objFile)) {
+        ModelInstance newModel(std::move(resource), false);
+        newModel.position = { 0, 0, 0 };
+        scene.addModel(newModel);
+        return;
     }
 
-    ModelInstance newModel(resourceCache[resourceKey], false);
-    newModel.position = { 0, 0, 0 };
-    scene.addModel(newModel);
-}
\ No newline at end of file
+    // Loads in the background, a wireframe cube stands in until it is done.
+    ModelInstance placeholder(ResourceLoader::placeholder(), false);
+    placeholder.pendingLoad = resourceLoader.load(folderPath, objFile, diffFile, nmFile, specFile);
+    placeholder.useDiffuse = false;
+    placeholder.useNormalMap = false;
+    placeholder.useSpecularMap = false;
+    placeholder.useWireframe = true;
+    scene.addModel(placeholder);
+}
+
+void Application::swapInLoadedResources() {
+    for (auto& loaded : resourceLoader.poll()) {
+        resources.add(loaded.key, loaded.resource);
+
+        for (auto& model : scene.models) {
+            if (model.pendingLoad != loaded.ticket) continue;
+
+            ModelInstance newModel(loaded.resource, model.useAlphaTest);
+            newModel.position = model.position;
+            newModel.rotation = model.rotation;
+            newModel.scale = model.scale;
+            model = newModel;
+        }
+    }
+
+    // Removed models leave their resources unused, dropped once over the budget.
+    resources.trim();
+}
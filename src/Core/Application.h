@@ -2,7 +2,14 @@
 #define RENDERER_APPLICATION_H
 
 #include "ModelInstance.h"
+#include "ResourceLoader.h"
+#include "ResourceManager.h"
 #include "../Renderer/Renderer.h"
+#include "../Renderer/FrameRing.h"
+#include "../Renderer/SceneSnapshots.h"
+#include "../Renderer/ResolutionScaler.h"
+#include "../Renderer/LodSelector.h"
+#include "../Utils/ThreadPool.h"
 #include "../Shaders/ScreenShader.h"
 
 #define GL_SILENCE_DEPRECATION
@@ -10,12 +17,12 @@
 #include <GLFW/glfw3.h>
 #include <cmath>
 #include <utility>
-#include <map>
 
 struct Application {
     Application(const int w, const int h, const char* name)
         : width(w), height(h), appName(name),
-          rb (RenderBuffers{width, height, width, height}),
+          resourceLoader(resources),
+          frames(width, height, width, height, PixelFormat::BGRA8, FRAME_RING_SIZE),
           scene({{0, 1, 6}, {0, 0, 0}, {0, 1, 0}, 3.0f}, (Vec3f(2, 3, 3).normalize() * 5.0f).normalize(), Vec3f(2, 3, 3).normalize() * 5.0f)
     {}
 
@@ -28,11 +35,28 @@ private:
     int width, height;
     const char *appName;
 
-    std::map<std::string, std::shared_ptr<ModelResource>> resourceCache;
-    RenderBuffers rb;
-    Scene scene;
+    static constexpr int FRAME_RING_SIZE = 3;
+    static constexpr double WORKER_STATS_INTERVAL = 0.5;
+    static constexpr float LATENCY_SMOOTHING = 0.1f;
+
+    ResourceManager resources;            // before resourceLoader, which loads into it.
+    ResourceLoader resourceLoader;
+    FrameRing frames;
+    ResolutionScaler resolutionScaler;
+    LodSelector lodSelector;
+    Scene scene;                          // front copy, edited by the UI and input only.
+    SceneSnapshots snapshots;
 
     unsigned int shaderProgram, VAO, texture;
+    int textureWidth = 0, textureHeight = 0;
+
+    std::vector<ThreadPool::WorkerStats> workerStats;
+    double workerStatsTime = 0.0;
+
+    float inputLatencyMs = 0.0f;
+    int lastPickedFace = -1;              // face of the last model removed by a click, see mouse_button_callback.
+    float lastPickedDistance = 0.0f;
+    RenderStats lastFrameStats;
 
     double lastX = 400.0f;
     double lastY = 400.0f;
@@ -54,6 +78,7 @@ private:
                          const std::string& diffFile,
                          const std::string& nmFile,
                          const std::string& specFile);
+    void swapInLoadedResources();
 };
 
 #endif //RENDERER_APPLICATION_H
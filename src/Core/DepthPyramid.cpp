@@ -0,0 +1,103 @@
+#include "DepthPyramid.h"
+#include "../Utils/TaskGroup.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void DepthPyramid::build(const AlignedVector<float>& zbuffer, const int width, const int height,
+                         const Matrix4f4& viewProj, const Vec3f& cameraPos, const Vec3f& cameraDir)
+{
+    this->width = width;
+    this->height = height;
+    this->viewProj = viewProj;
+    this->cameraPos = cameraPos;
+    this->cameraDir = cameraDir;
+
+    // Levels keep their storage between frames, only a resize reallocates.
+    int levelCount = 0;
+    for (int w = width, h = height; w > 1 || h > 1; w = (w + 1) / 2, h = (h + 1) / 2) levelCount++;
+    levels.resize(std::max(levelCount, 1));
+
+    const float* source = zbuffer.data();
+    int sourceW = width, sourceH = height;
+
+    for (auto& level : levels) {
+        level.width = (sourceW + 1) / 2;
+        level.height = (sourceH + 1) / 2;
+        level.depth.resize(static_cast<size_t>(level.width) * level.height);
+
+        // Odd sizes - the last texel of a row or column covers a single source pixel.
+        parallelFor(0, level.height, ROW_GRAIN, [&](const int begin, const int end) {
+            for (int y = begin; y < end; ++y) {
+                const int y0 = 2 * y;
+                const int y1 = std::min(y0 + 1, sourceH - 1);
+                for (int x = 0; x < level.width; ++x) {
+                    const int x0 = 2 * x;
+                    const int x1 = std::min(x0 + 1, sourceW - 1);
+                    level.depth[x + y * level.width] = std::min(
+                        std::min(source[x0 + y0 * sourceW], source[x1 + y0 * sourceW]),
+                        std::min(source[x0 + y1 * sourceW], source[x1 + y1 * sourceW]));
+                }
+            }
+        });
+
+        source = level.depth.data();
+        sourceW = level.width;
+        sourceH = level.height;
+    }
+
+    valid = true;
+}
+
+bool DepthPyramid::isOccluded(const Vec3f& min, const Vec3f& max, const Matrix4f4& toClip) const
+{
+    if (!valid) return false;
+
+    float minX = std::numeric_limits<float>::max(), minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest(), maxY = std::numeric_limits<float>::lowest();
+    float nearest = std::numeric_limits<float>::lowest();
+
+    for (int corner = 0; corner < 8; ++corner) {
+        const Vec3f p(corner & 1 ? max.x() : min.x(), corner & 2 ? max.y() : min.y(), corner & 4 ? max.z() : min.z());
+        const Vec4f clip = toClip * Vec4f(p);
+        if (clip.w() <= 0.0f) return false;
+
+        // Same mapping as the viewport matrix.
+        const float invW = 1.0f / clip.w();
+        const float x = (clip.x() * invW + 1.0f) * 0.5f * static_cast<float>(width);
+        const float y = (clip.y() * invW + 1.0f) * 0.5f * static_cast<float>(height);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::max(nearest, clip.z() * invW * 0.5f + 0.5f);
+    }
+
+    // Off the frame there is no depth to test against.
+    if (minX < 0.0f || minY < 0.0f || maxX >= static_cast<float>(width) || maxY >= static_cast<float>(height)) {
+        return false;
+    }
+
+    // One pixel of margin for the rasterizer's truncation.
+    const int x0 = std::max(0, static_cast<int>(minX) - 1);
+    const int y0 = std::max(0, static_cast<int>(minY) - 1);
+    const int x1 = std::min(width - 1, static_cast<int>(maxX) + 1);
+    const int y1 = std::min(height - 1, static_cast<int>(maxY) + 1);
+
+    // Coarsest detail needed - the first level where the rect spans at most MAX_TEST_TEXELS per axis.
+    int l = 0;
+    while (l + 1 < levelCount() &&
+           ((x1 >> (l + 1)) - (x0 >> (l + 1)) >= MAX_TEST_TEXELS ||
+            (y1 >> (l + 1)) - (y0 >> (l + 1)) >= MAX_TEST_TEXELS)) {
+        l++;
+    }
+
+    const Level& level = levels[l];
+    for (int ty = y0 >> (l + 1); ty <= y1 >> (l + 1); ++ty) {
+        for (int tx = x0 >> (l + 1); tx <= x1 >> (l + 1); ++tx) {
+            if (nearest >= level.at(tx, ty)) return false;
+        }
+    }
+    return true;
+}
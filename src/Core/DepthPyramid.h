@@ -0,0 +1,73 @@
+#ifndef RENDERER_DEPTHPYRAMID_H
+#define RENDERER_DEPTHPYRAMID_H
+
+#include "../Math/Matrix.h"
+#include "../Utils/AlignedAllocator.h"
+#include <vector>
+
+/**
+ * Hierarchical depth (Hi-Z) of a finished frame, used to skip geometry hidden
+ * behind what that frame drew. Larger depth is closer, so every texel keeps the
+ * smallest (farthest) depth of the pixels it covers - anything whose nearest
+ * point is farther than that is certainly behind the frame's surfaces there.
+ * Level 0 is half the frame resolution, each next level halves it again.
+ */
+class DepthPyramid {
+public:
+    /**
+     * @brief Builds the pyramid from a finished depth buffer.
+     *
+     * @param zbuffer                   Depth of the frame, row-major.
+     * @param width                               Frame width in pixels.
+     * @param height                             Frame height in pixels.
+     * @param viewProj      The frame's world to clip space transform.
+     * @param cameraPos                      Camera position of the frame.
+     * @param cameraDir            Normalized view direction of the frame.
+     */
+    void build(const AlignedVector<float>& zbuffer, int width, int height,
+               const Matrix4f4& viewProj, const Vec3f& cameraPos, const Vec3f& cameraDir);
+
+    void invalidate() { valid = false; }
+
+    /**
+     * @brief Conservative occlusion test of a box. False whenever unsure - the
+     *        box crosses the camera plane, or leaves the frame.
+     *
+     * @param min                                   Box minimum corner.
+     * @param max                                   Box maximum corner.
+     * @param toClip     Box space to the pyramid frame's clip space, e.g.
+     *                   getViewProj() for a world box or getViewProj() * model for a model box.
+     * @return                    true if the whole box is behind the depth.
+     */
+    [[nodiscard]] bool isOccluded(const Vec3f& min, const Vec3f& max, const Matrix4f4& toClip) const;
+
+    [[nodiscard]] bool isValid() const { return valid; }
+    [[nodiscard]] const Matrix4f4& getViewProj() const { return viewProj; }
+    [[nodiscard]] const Vec3f& getCameraPos() const { return cameraPos; }
+    [[nodiscard]] const Vec3f& getCameraDir() const { return cameraDir; }
+    [[nodiscard]] int levelCount() const { return static_cast<int>(levels.size()); }
+
+private:
+    struct Level {
+        int width = 0;
+        int height = 0;
+        std::vector<float> depth;
+
+        [[nodiscard]] float at(const int x, const int y) const { return depth[x + y * width]; }
+    };
+
+    std::vector<Level> levels;
+    int width = 0;
+    int height = 0;
+    Matrix4f4 viewProj;
+    Vec3f cameraPos;
+    Vec3f cameraDir;
+    bool valid = false;
+
+    // Rows per task while reducing.
+    static constexpr int ROW_GRAIN = 16;
+    // Texels per axis a test may read, the level is picked so the box fits.
+    static constexpr int MAX_TEST_TEXELS = 4;
+};
+
+#endif //RENDERER_DEPTHPYRAMID_H
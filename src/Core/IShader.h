@@ -4,6 +4,7 @@
 #include "../Math/Vec.h"
 #include "../Math/Matrix.h"
 #include "../IO/tgaimage.h"
+#include "../Utils/AlignedAllocator.h"
 
 /**
  * Contains the pixel's relevant geometrical information
@@ -39,7 +40,7 @@ struct Uniforms {
     Matrix4f4 lightSpaceMatrix;
 
     Matrix4f4 lightProjView;
-    const std::vector<float>* shadowMap = nullptr;
+    const AlignedVector<float>* shadowMap = nullptr;
     int shadowWidth = 0;
     int shadowHeight = 0;
 };
@@ -68,6 +69,37 @@ public:
                             const Vec3f& tangent,
                             const Vec3f& bitangent) = 0;
 
+    /**
+     * @brief Same as above, for a vertex already transformed to clip space -
+     *        the batched path of the rasterizer transforms a mesh's vertices
+     *        once per instance, see transformVertices.
+     *
+     * @param clip -         localPos under projection * modelView.
+     */
+    virtual Varyings vertex(const Vec4f& clip,
+                            const Vec3f& localPos,
+                            const Vec3f& normal,
+                            const Vec2f& uv,
+                            const Vec3f& tangent,
+                            const Vec3f& bitangent) = 0;
+
+    /**
+     * @brief Perspective divide and viewport transform of a clip space position.
+     *        Every shader maps through it, so the rasterizer can test a
+     *        triangle's screen area before shading its vertices.
+     *
+     * @param viewport -                        the viewport matrix.
+     * @param clip -                     the clip space position.
+     * @param invW -                  receives 1 / clip.w.
+     * @return -                           the screen position.
+     */
+    static Vec3f toScreen(const Matrix4f4& viewport, const Vec4f& clip, float& invW)
+    {
+        invW = 1.0f / clip.w();
+        const Vec4f screen = viewport * (clip * invW);
+        return Vec3f(screen.x(), screen.y(), screen.z());
+    }
+
     /**
      * @brief Calculates the final color given the varyings and color.
      *        Lighting calculations also happen in this function.
@@ -4,6 +4,14 @@
 #include "Matrix.h"
 #include "../IO/tgaimage.h"
 #include "../IO/ModelLoader.h"
+#include "../IO/MeshSimplifier.h"
+#include "../IO/MeshCache.h"
+#include "TriangleBVH.h"
+#include "../Utils/TaskGroup.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
 
 struct AABB {
     Vec3f min;
@@ -16,34 +24,128 @@ struct AABB {
 };
 
 struct ModelResource {
-    ModelLoader model;
-    TGAImage diffuse;
-    TGAImage normal;
-    TGAImage specular;
+    std::shared_ptr<const MeshCacheData> mesh;      // every level of detail, may be shared with other resources.
+    const ModelLoader& model;                       // the full model, the first level of mesh.
+    std::shared_ptr<const TGAImage> diffuse;        // the maps are never null, may be shared too.
+    std::shared_ptr<const TGAImage> normal;
+    std::shared_ptr<const TGAImage> specular;
     AABB localBBox;
 
+    // Loads everything on the calling thread, see ResourceLoader for loading in the background.
     ModelResource(const std::string& modelRoot,
                   const std::string &objPath,
                   const std::string &diffPath,
                   const std::string &nmPath,
                   const std::string &specPath)
-        : model(modelRoot + objPath) {
+        : ModelResource(std::make_shared<const MeshCacheData>(loadMesh(modelRoot + objPath)),
+                        emptyTexture(), emptyTexture(), emptyTexture()) {
+        // The three maps decode side by side.
+        TaskGroup group;
+        group.run([&] { diffuse = loadTexture(modelRoot + diffPath); });
+        group.run([&] { normal = loadTexture(modelRoot + nmPath); });
+        group.run([&] { specular = loadTexture(modelRoot + specPath); });
+        group.wait();
+    }
+
+    // Resource from parts loaded separately with loadMesh and loadTexture.
+    ModelResource(std::shared_ptr<const MeshCacheData> meshData, std::shared_ptr<const TGAImage> diffuseMap,
+                  std::shared_ptr<const TGAImage> normalMap, std::shared_ptr<const TGAImage> specularMap)
+        : mesh(std::move(meshData)), model(mesh->levels.front()),
+          diffuse(std::move(diffuseMap)), normal(std::move(normalMap)), specular(std::move(specularMap)) {
+        localBBox.min = mesh->boundsMin;
+        localBBox.max = mesh->boundsMax;
+    }
+
+    // Untextured resource around an already loaded mesh.
+    explicit ModelResource(ModelLoader fullModel)
+        : ModelResource(std::make_shared<const MeshCacheData>(processMesh(std::move(fullModel))),
+                        emptyTexture(), emptyTexture(), emptyTexture()) {}
+
+    // Level 0 is the full model, levels past the coarsest one clamp to it.
+    [[nodiscard]] const ModelLoader& lod(const int level) const {
+        return mesh->levels[std::clamp(level, 0, lodCount() - 1)];
+    }
+
+    [[nodiscard]] int lodCount() const { return static_cast<int>(mesh->levels.size()); }
+
+    // Faces of model for ray queries, built by the first query - picking is rare,
+    // and the build would be most of the load time of a cached mesh.
+    [[nodiscard]] const TriangleBVH& triangleBVH() const {
+        std::call_once(triangleBVHBuilt, [this] { triangles.build(model); });
+        return triangles;
+    }
+
+    static constexpr int MAX_LODS = 4;
+    static constexpr int MIN_LOD_FACES = 64;
+
+    // The processed mesh of an OBJ file, from its mesh cache when that is up to date (refreshed otherwise).
+    // A parse runs on pool, so background loads can keep it off the workers that render.
+    static MeshCacheData loadMesh(const std::string& objPath, ThreadPool& pool = ThreadPool::instance()) {
+        MeshCacheData mesh;
+        if (readMeshCache(objPath, mesh, pool)) return mesh;
+
+        mesh = processMesh(ModelLoader(objPath, pool));
+        writeMeshCache(objPath, mesh);
+        return mesh;
+    }
 
-        diffuse.read_tga_file(modelRoot + diffPath);
-        normal.read_tga_file(modelRoot + nmPath);
-        specular.read_tga_file(modelRoot + specPath);
+    // Rows bottom-up, the orientation the shaders sample in. Empty if the file cannot be read.
+    static std::shared_ptr<const TGAImage> loadTexture(const std::string& path) {
+        auto image = std::make_shared<TGAImage>();
+        image->read_tga_file(path, true);
+        return image;
+    }
+
+    // Stands in for a map that was not loaded, shared by every resource.
+    static std::shared_ptr<const TGAImage> emptyTexture() {
+        static const auto empty = std::make_shared<const TGAImage>();
+        return empty;
+    }
 
-        diffuse.flip_vertically();
-        normal.flip_vertically();
-        specular.flip_vertically();
+private:
+    // The levels of detail and the bounds of a full model.
+    static MeshCacheData processMesh(ModelLoader fullModel) {
+        MeshCacheData mesh;
+        mesh.levels.push_back(std::move(fullModel));
+        for (auto& level : buildLods(mesh.levels.front())) mesh.levels.push_back(std::move(level));
 
-        for (const auto& v : model.getVertices()) {
+        const AABB bounds = computeBounds(mesh.levels.front());
+        mesh.boundsMin = bounds.min;
+        mesh.boundsMax = bounds.max;
+        return mesh;
+    }
+
+    static AABB computeBounds(const ModelLoader& mesh) {
+        AABB bounds;
+        for (const auto& v : mesh.getVertices()) {
             for (int i = 0; i < 3; ++i) {
-                localBBox.min[i] = std::min(localBBox.min[i], v[i]);
-                localBBox.max[i] = std::max(localBBox.max[i], v[i]);
+                bounds.min[i] = std::min(bounds.min[i], v[i]);
+                bounds.max[i] = std::max(bounds.max[i], v[i]);
             }
         }
+        return bounds;
+    }
+
+    // Halves the face count per level, stops once the simplifier can no longer make real progress.
+    static std::vector<ModelLoader> buildLods(const ModelLoader& model) {
+        std::vector<ModelLoader> lods;
+        lods.reserve(MAX_LODS);
+        const ModelLoader* previous = &model;
+        while (static_cast<int>(lods.size()) < MAX_LODS) {
+            const int faces = static_cast<int>(previous->getFaces().size());
+            if (faces / 2 < MIN_LOD_FACES) break;
+
+            ModelLoader simplified = simplifyMesh(*previous, faces / 2);
+            if (simplified.getFaces().size() * 10 > static_cast<size_t>(faces) * 9) break;
+
+            lods.push_back(std::move(simplified));
+            previous = &lods.back();
+        }
+        return lods;
     }
+
+    mutable TriangleBVH triangles;
+    mutable std::once_flag triangleBVHBuilt;
 };
 
 struct ModelInstance {
@@ -61,28 +163,27 @@ struct ModelInstance {
     Vec3f rotation = {0, 0, 0}; // Euler angles in degrees
     Vec3f scale = {1, 1, 1};
 
+    int lod = 0;                // level of detail drawn, see LodSelector.
+    int pendingLoad = -1;       // ResourceLoader ticket while resource is a placeholder, -1 otherwise.
+
     ModelInstance(std::shared_ptr<ModelResource> res, const bool useAlpha)
         : resource(std::move(res)), useAlphaTest(useAlpha) {}
 
+    // Cached unless position, rotation or scale changed since the last updateTransform.
     [[nodiscard]] Matrix4f4 getModelMatrix() const {
-        const Matrix4f4 T = Matrix4f4::translation(position);
-        const Matrix4f4 S = Matrix4f4::scale(scale.x(), scale.y(), scale.z());
-
-        // Rotation Order: Z -> Y -> X
-        const Matrix4f4 Rx = Matrix4f4::rotationX(rotation.x());
-        const Matrix4f4 Ry = Matrix4f4::rotationY(rotation.y());
-        const Matrix4f4 Rz = Matrix4f4::rotationZ(rotation.z());
-
-        return T * (Rx * Ry * Rz) * S;
+        if (isTransformCached()) return cachedModel;
+        return computeModelMatrix();
     }
 
-    void updateBBox() const {
-        for (const auto& v: resource->model.getVertices()) {
-            for (int i = 0 ; i < 3; ++i) {
-                resource->localBBox.min[i] = std::min(resource->localBBox.min[i], v[i]);
-                resource->localBBox.max[i] = std::max(resource->localBBox.max[i], v[i]);
-            }
-        }
+    // Refreshes the cached model matrix. Not done lazily by getModelMatrix,
+    // which may run on several threads at once - Scene::updateBounds calls it.
+    void updateTransform() {
+        if (isTransformCached()) return;
+        cachedModel = computeModelMatrix();
+        cachedPosition = position;
+        cachedRotation = rotation;
+        cachedScale = scale;
+        hasCachedModel = true;
     }
 
     [[nodiscard]] AABB getWorldAABB() const {
@@ -112,6 +213,24 @@ struct ModelInstance {
         return worldAABB;
     }
 
+    /**
+     * @brief Nearest face of the model hit by a world space ray. The ray is
+     *        brought into model space, where the resource's triangle BVH is
+     *        shared by all the instances. Distances stay in units of dir.
+     *
+     * @param origin                            Ray origin, world space.
+     * @param dir      Ray direction, world space, need not be normalized.
+     * @param hit     Only faces closer than hit.t count, updated on a hit.
+     * @return                                  true if hit was updated.
+     */
+    bool raycast(const Vec3f& origin, const Vec3f& dir, TriangleBVH::Hit& hit) const {
+        const Matrix4f4 toModel = getModelMatrix().inverse4x4();
+        const Vec4f localOrigin = toModel * Vec4f(origin);
+        const Vec4f localDir = toModel * Vec4f(dir.x(), dir.y(), dir.z(), 0.0f);
+
+        return resource->triangleBVH().raycast(Vec3f(localOrigin), Vec3f(localDir), hit);
+    }
+
     [[nodiscard]] static float RayBoxInterSection(Vec3f rayOrigin, Vec3f rayDir, Vec3f min, Vec3f max) {
         float tNear = std::numeric_limits<float>::lowest();
         float tFar = std::numeric_limits<float>::max();
@@ -132,6 +251,34 @@ struct ModelInstance {
 
         return (tFar >= 0) ? tNear : -1.0f;
     }
+
+private:
+    [[nodiscard]] bool isTransformCached() const {
+        if (!hasCachedModel) return false;
+        for (int i = 0; i < 3; ++i) {
+            if (position[i] != cachedPosition[i] || rotation[i] != cachedRotation[i] ||
+                scale[i] != cachedScale[i]) return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] Matrix4f4 computeModelMatrix() const {
+        const Matrix4f4 T = Matrix4f4::translation(position);
+        const Matrix4f4 S = Matrix4f4::scale(scale.x(), scale.y(), scale.z());
+
+        // Rotation Order: Z -> Y -> X
+        const Matrix4f4 Rx = Matrix4f4::rotationX(rotation.x());
+        const Matrix4f4 Ry = Matrix4f4::rotationY(rotation.y());
+        const Matrix4f4 Rz = Matrix4f4::rotationZ(rotation.z());
+
+        return T * (Rx * Ry * Rz) * S;
+    }
+
+    Matrix4f4 cachedModel;
+    Vec3f cachedPosition;
+    Vec3f cachedRotation;
+    Vec3f cachedScale;
+    bool hasCachedModel = false;
 };
 
 #endif //RENDERER_MODELINSTANCE_H
\ No newline at end of file
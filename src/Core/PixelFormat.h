@@ -0,0 +1,70 @@
+#ifndef RENDERER_PIXELFORMAT_H
+#define RENDERER_PIXELFORMAT_H
+
+#include "../IO/tgaimage.h"
+#include <bit>
+#include <cstdint>
+
+static_assert(std::endian::native == std::endian::little,
+              "Packed pixel formats assume a little-endian host.");
+
+/**
+ * Memory order of the 4 channels of a packed 32-bit pixel.
+ * RGBA8 uploads as GL_RGBA, BGRA8 as GL_BGRA (the TGA / native swap chain order).
+ * Alpha is always the highest byte so both formats share the same modulation code.
+ */
+enum class PixelFormat {
+    RGBA8,
+    BGRA8
+};
+
+namespace PackedColor {
+    constexpr std::uint32_t ALPHA_MASK = 0xFF000000u;
+    constexpr std::uint32_t RED_BLUE_MASK = 0x00FF00FFu;
+    constexpr std::uint32_t GREEN_MASK = 0x0000FF00u;
+    constexpr int MODULATE_ONE = 256;
+
+    /**
+     * @brief Packs a shader output color into a single 32-bit pixel.
+     *
+     * @param c               color in TGA (b, g, r, a) channel order.
+     * @param format                         destination pixel format.
+     * @return                            the opaque packed pixel.
+     */
+    inline std::uint32_t pack(const TGAColor& c, const PixelFormat format)
+    {
+        const std::uint32_t b = c.bgra[0];
+        const std::uint32_t g = c.bgra[1];
+        const std::uint32_t r = c.bgra[2];
+
+        if (format == PixelFormat::BGRA8) {
+            return b | (g << 8) | (r << 16) | ALPHA_MASK;
+        }
+        return r | (g << 8) | (b << 16) | ALPHA_MASK;
+    }
+
+    /**
+     * @brief Scales the color channels of a packed pixel, alpha untouched.
+     *        Red and blue are multiplied together in one register (SWAR),
+     *        so the loop over a row vectorizes to plain integer ops.
+     *
+     * @param pixel                               packed pixel, any format.
+     * @param factor     fixed point scale in [0, MODULATE_ONE] (256 == 1.0).
+     * @return                                        the modulated pixel.
+     */
+    inline std::uint32_t modulate(const std::uint32_t pixel, const std::uint32_t factor)
+    {
+        const std::uint32_t rb = (((pixel & RED_BLUE_MASK) * factor) >> 8) & RED_BLUE_MASK;
+        const std::uint32_t g = (((pixel & GREEN_MASK) * factor) >> 8) & GREEN_MASK;
+        return rb | g | (pixel & ALPHA_MASK);
+    }
+
+    // Returns the channel value (0 = red, 1 = green, 2 = blue) of a packed pixel.
+    inline std::uint8_t channel(const std::uint32_t pixel, const int rgbIndex, const PixelFormat format)
+    {
+        const int byte = (format == PixelFormat::BGRA8) ? 2 - rgbIndex : rgbIndex;
+        return static_cast<std::uint8_t>(pixel >> (byte * 8));
+    }
+}
+
+#endif //RENDERER_PIXELFORMAT_H
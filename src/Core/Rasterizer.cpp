@@ -1,18 +1,20 @@
 #include "Rasterizer.h"
-#include <thread>
 #include <vector>
 #include <atomic>
 #include <algorithm>
-#include "../Utils/ThreadPool.h"
-
-constexpr int TILE_SIZE = 32;
-
-struct Tile {
-    std::vector<int> triangleIndices;
-};
-
-struct ProcessedTriangle {
-    Varyings varyings[3];
+#include <functional>
+#include "../Utils/TaskGroup.h"
+
+/**
+ * Tile-local copy of the target. Rows are TILE_SIZE apart, so a 32x32 tile
+ * is one contiguous ~20KB block that stays in L1/L2 while all of the
+ * tile's triangles are rasterized, instead of 32 rows 'width' apart.
+ */
+struct alignas(64) TileBuffer {
+    float depth[TILE_SIZE * TILE_SIZE];
+    std::uint32_t color[TILE_SIZE * TILE_SIZE];
+    Vec3f normal[TILE_SIZE * TILE_SIZE];
+    int minX = 0, minY = 0, maxX = 0, maxY = 0;
 };
 
 Point3 barycentric(const Vec2f& A, const Vec2f& B, const Vec2f& C, const Vec2f& P)
@@ -46,15 +48,15 @@ BBox computeTriangleBBox(const Vec3f pts[3])
 }
 
 void drawTriangleClipped(const Varyings varyings[3], IShader &shader, const RenderContext &ctx,
-                         const int tileMinX, const int tileMinY, const int tileMaxX, const int tileMaxY)
+                         TileBuffer &tile)
 {
     Vec3f pts[3] = { varyings[0].screenPos, varyings[1].screenPos, varyings[2].screenPos };
     BBox bbox = computeTriangleBBox(pts);
 
-    const int minX = std::max(tileMinX, (int)bbox._boxMin.x());
-    const int maxX = std::min(tileMaxX, (int)bbox._boxMax.x());
-    const int minY = std::max(tileMinY, (int)bbox._boxMin.y());
-    const int maxY = std::min(tileMaxY, (int)bbox._boxMax.y());
+    const int minX = std::max(tile.minX, (int)bbox._boxMin.x());
+    const int maxX = std::min(tile.maxX, (int)bbox._boxMax.x());
+    const int minY = std::max(tile.minY, (int)bbox._boxMin.y());
+    const int maxY = std::min(tile.maxY, (int)bbox._boxMax.y());
 
     if (minX > maxX || minY > maxY) return;
 
@@ -68,159 +70,520 @@ void drawTriangleClipped(const Varyings varyings[3], IShader &shader, const Rend
             if (bc.x() < 0 || bc.y() < 0 || bc.z() < 0) continue;
 
             float z = pts[0].z() * bc.x() + pts[1].z() * bc.y() + pts[2].z() * bc.z();
-            int index = x + y * ctx.width;
+            const int index = (x - tile.minX) + (y - tile.minY) * TILE_SIZE;
 
-            if (ctx.zbuffer[index] < z) {
+            if (tile.depth[index] < z) {
                 TGAColor color;
                 Varyings pixelVaryings = IShader::interpolate(varyings[0], varyings[1], varyings[2], bc);
                 pixelVaryings.barycentric = bc;
 
                 if (!shader.fragment(pixelVaryings, color)) {
-                    ctx.zbuffer[index] = z;
-                    if (ctx.colorBuffer) {
-                        int colorIdx = index * 3;
-                        (* ctx.colorBuffer)[colorIdx] = color.bgra[2];
-                        (* ctx.colorBuffer)[colorIdx + 1] = color.bgra[1];
-                        (* ctx.colorBuffer)[colorIdx + 2] = color.bgra[0];
-                    }
-                    if (ctx.normalBuffer) (*ctx.normalBuffer)[index] = varyings->normalForBuffer;
+                    tile.depth[index] = z;
+                    if (ctx.colorBuffer) tile.color[index] = PackedColor::pack(color, ctx.colorFormat);
+                    if (ctx.normalBuffer) tile.normal[index] = pixelVaryings.normalForBuffer;
                 }
             }
         }
     }
 }
 
-std::pair<Vec3f, Vec3f> calculateTriangleBasis(const Vec3f pts[3], const Vec2f uvs[3])
+inline void clearTile(const RenderContext& ctx,
+                      const int minX, const int minY, const int maxX, const int maxY)
 {
-    Vec3f edge1 = pts[1] - pts[0];
-    Vec3f edge2 = pts[2] - pts[0];
+    for (int y = minY; y <= maxY; ++y) {
+        const int rowStart = minX + y * ctx.width;
+        const int rowEnd = maxX + 1 + y * ctx.width;
 
-    Vec2f deltaUV1 = uvs[1] - uvs[0];
-    Vec2f deltaUV2 = uvs[2] - uvs[0];
+        std::fill(ctx.zbuffer.begin() + rowStart, ctx.zbuffer.begin() + rowEnd, DEPTH_CLEAR_VALUE);
+        if (ctx.colorBuffer) {
+            std::fill(ctx.colorBuffer->begin() + rowStart, ctx.colorBuffer->begin() + rowEnd, 0u);
+        }
+        if (ctx.normalBuffer) {
+            std::fill(ctx.normalBuffer->begin() + rowStart, ctx.normalBuffer->begin() + rowEnd, Vec3f(0, 0, 0));
+        }
+    }
+}
 
-    const float f = 1.0f / (deltaUV1.x() * deltaUV2.y() - deltaUV2.x() * deltaUV1.y());
+/**
+ * Copies the target tile into the tile-local block. A tile that is stale
+ * this frame (see TileClearState) starts from the clear value instead,
+ * so it is never read from memory at all.
+ */
+inline void loadTile(const RenderContext& ctx, const int tileIdx, TileBuffer& tile)
+{
+    const int tileW = tile.maxX - tile.minX + 1;
+    const bool clear = ctx.clearState && ctx.clearState->needsClear(tileIdx);
+
+    for (int y = tile.minY; y <= tile.maxY; ++y) {
+        const int local = (y - tile.minY) * TILE_SIZE;
+        const int global = tile.minX + y * ctx.width;
+
+        if (clear) {
+            std::fill_n(tile.depth + local, tileW, DEPTH_CLEAR_VALUE);
+            if (ctx.colorBuffer) std::fill_n(tile.color + local, tileW, 0u);
+            if (ctx.normalBuffer) std::fill_n(tile.normal + local, tileW, Vec3f(0, 0, 0));
+        } else {
+            std::copy_n(ctx.zbuffer.data() + global, tileW, tile.depth + local);
+            if (ctx.colorBuffer) std::copy_n(ctx.colorBuffer->data() + global, tileW, tile.color + local);
+            if (ctx.normalBuffer) std::copy_n(ctx.normalBuffer->data() + global, tileW, tile.normal + local);
+        }
+    }
+}
 
-    Vec3f tangent, bitangent;
-    tangent.x() = f * (deltaUV2.y() * edge1.x() - deltaUV1.y() * edge2.x());
-    tangent.y() = f * (deltaUV2.y() * edge1.y() - deltaUV1.y() * edge2.y());
-    tangent.z() = f * (deltaUV2.y() * edge1.z() - deltaUV1.y() * edge2.z());
+// Writes the finished tile back to the target, one linear copy per row.
+inline void flushTile(const RenderContext& ctx, const int tileIdx, const TileBuffer& tile)
+{
+    const int tileW = tile.maxX - tile.minX + 1;
 
-    bitangent.x() = f * (-deltaUV2.x() * edge1.x() + deltaUV1.x() * edge2.x());
-    bitangent.y() = f * (-deltaUV2.x() * edge1.y() + deltaUV1.x() * edge2.y());
-    bitangent.z() = f * (-deltaUV2.x() * edge1.z() + deltaUV1.x() * edge2.z());
+    for (int y = tile.minY; y <= tile.maxY; ++y) {
+        const int local = (y - tile.minY) * TILE_SIZE;
+        const int global = tile.minX + y * ctx.width;
 
-    return {tangent.normalize(), bitangent.normalize()};
+        std::copy_n(tile.depth + local, tileW, ctx.zbuffer.data() + global);
+        if (ctx.colorBuffer) std::copy_n(tile.color + local, tileW, ctx.colorBuffer->data() + global);
+        if (ctx.normalBuffer) std::copy_n(tile.normal + local, tileW, ctx.normalBuffer->data() + global);
+    }
+
+    if (ctx.clearState) ctx.clearState->markCleared(tileIdx);
 }
 
-inline std::vector<ProcessedTriangle> preProcessVertices(const ModelLoader& model, IShader& shader)
+MeshletCuller::MeshletCuller(const Matrix4f4& clip)
+    : frustum(Frustum::fromMatrix(clip)),
+      clipW(clip[0][3], clip[1][3], clip[2][3], clip[3][3])
 {
-    const auto& faces = model.getFaces();
-    std::vector<ProcessedTriangle> processed;
-    processed.reserve(faces.size());
+    // Cofactors of the z row - a null vector of the x, y and w rows, so it is the
+    // point (or direction, if w is 0) everything is projected towards.
+    // With it the screen space winding the rasterizer culls by is
+    // sign(dot(n, eye.xyz - eye.w * p)) for a face with normal n through p, as long as w > 0.
+    constexpr int rows[3] = { 0, 1, 3 };
+    for (int col = 0; col < 4; ++col) {
+        int cols[3], k = 0;
+        for (int c = 0; c < 4; ++c) {
+            if (c != col) cols[k++] = c;
+        }
+        auto at = [&](const int r, const int c) { return clip[cols[c]][rows[r]]; };
+        const float minor = at(0, 0) * (at(1, 1) * at(2, 2) - at(1, 2) * at(2, 1)) -
+                            at(0, 1) * (at(1, 0) * at(2, 2) - at(1, 2) * at(2, 0)) +
+                            at(0, 2) * (at(1, 0) * at(2, 1) - at(1, 1) * at(2, 0));
+        eye[col] = col % 2 == 0 ? minor : -minor;
+    }
+}
+
+MeshletCuller::MeshletCuller(const Matrix4f4& clip, const DepthPyramid* occluders, const Matrix4f4& occluderClip)
+    : MeshletCuller(clip)
+{
+    this->occluders = occluders;
+    this->occluderClip = occluderClip;
+}
+
+bool MeshletCuller::isVisible(const Meshlet& meshlet) const
+{
+    const Vec3f& center = meshlet.center;
+    const float radius = meshlet.radius;
 
-    for (const auto& face: faces) {
-        auto [tangent, bitangent] = calculateTriangleBasis(face.pts, face.uv);
+    if (!frustum.intersectsSphere(center, radius)) return false;
+    if (!isFrontFacing(meshlet)) return false;
 
-        ProcessedTriangle pt;
+    const Vec3f extent(radius, radius, radius);
+    return !occluders || !occluders->isOccluded(center - extent, center + extent, occluderClip);
+}
+
+bool MeshletCuller::isFrontFacing(const Meshlet& meshlet) const
+{
+    const Vec3f& center = meshlet.center;
+    const float radius = meshlet.radius;
+
+    if (meshlet.coneCutoff >= 1.0f) return true;
+
+    // The winding test only holds in front of the viewpoint, so the whole sphere must be at w > 0.
+    const Vec3f wNormal(clipW[0], clipW[1], clipW[2]);
+    if (dotProduct(wNormal, center) + clipW[3] <= wNormal.length() * radius) return true;
+
+    // Back facing if dot(n, view) >= 0 for every normal in the cone and every point in the sphere.
+    const Vec3f view = center * eye[3] - Vec3f(eye[0], eye[1], eye[2]);
+    const float slack = std::abs(eye[3]) * radius * (1.0f + meshlet.coneCutoff);
+    return dotProduct(view, meshlet.coneAxis) < meshlet.coneCutoff * view.length() + slack;
+}
 
-        for (int j = 0; j < 3; j++) {
-            pt.varyings[j] =
-                shader.vertex(face.pts[j], face.normals[j], face.uv[j], tangent, bitangent);
+// Faces per vertex processing chunk, meshlets per culling chunk, vertices per transform chunk,
+// and triangles per binning chunk.
+constexpr int VERTEX_GRAIN = 1024;
+constexpr int MESHLET_GRAIN = VERTEX_GRAIN / MESHLET_SIZE;
+constexpr int CULLING_GRAIN = 256;
+constexpr int TRANSFORM_GRAIN = 4096;
+constexpr int BINNING_GRAIN = 4096;
+
+void transformVertices(const VertexStreams& streams, const Matrix4f4& clip, ClipPositions& out,
+                       const int begin, const int end, const int offset)
+{
+    const float* __restrict sx = streams.x.data();
+    const float* __restrict sy = streams.y.data();
+    const float* __restrict sz = streams.z.data();
+    float* __restrict ox = out.x.data() + offset;
+    float* __restrict oy = out.y.data() + offset;
+    float* __restrict oz = out.z.data() + offset;
+    float* __restrict ow = out.w.data() + offset;
+
+    // Rows of the matrix as scalars, broadcast across the vertex lanes.
+    const float m00 = clip[0][0], m10 = clip[1][0], m20 = clip[2][0], m30 = clip[3][0];
+    const float m01 = clip[0][1], m11 = clip[1][1], m21 = clip[2][1], m31 = clip[3][1];
+    const float m02 = clip[0][2], m12 = clip[1][2], m22 = clip[2][2], m32 = clip[3][2];
+    const float m03 = clip[0][3], m13 = clip[1][3], m23 = clip[2][3], m33 = clip[3][3];
+
+    for (int i = begin; i < end; ++i) {
+        const float x = sx[i], y = sy[i], z = sz[i];
+        ox[i] = m00 * x + m10 * y + m20 * z + m30;
+        oy[i] = m01 * x + m11 * y + m21 * z + m31;
+        oz[i] = m02 * x + m12 * y + m22 * z + m32;
+        ow[i] = m03 * x + m13 * y + m23 * z + m33;
+    }
+}
+
+// Visibility of every meshlet of every draw into scratch.visible, one parallel loop
+// over all the draws. Returns the number of meshlets culled.
+inline int cullMeshlets(const std::vector<DrawCall>& draws, GeometryScratch& scratch)
+{
+    const int numDraws = static_cast<int>(draws.size());
+    auto& chunks = scratch.batches;
+    chunks.clear();
+    scratch.firstMeshlet.resize(numDraws);
+
+    int numMeshlets = 0;
+    for (int d = 0; d < numDraws; ++d) {
+        const int count = static_cast<int>(draws[d].model->getMeshlets().size());
+        scratch.firstMeshlet[d] = numMeshlets;
+        for (int first = 0; first < count; first += CULLING_GRAIN) {
+            chunks.push_back({ d, first, std::min(first + CULLING_GRAIN, count) });
         }
+        numMeshlets += count;
+    }
+    scratch.visible.resize(numMeshlets);
+
+    std::atomic<int> culled = 0;
+    parallelFor(0, static_cast<int>(chunks.size()), 1, [&](const int begin, const int end) {
+        int chunkCulled = 0;
+        for (int c = begin; c < end; ++c) {
+            const auto [d, first, last] = chunks[c];
+            const DrawCall& draw = draws[d];
+            const IShader& shader = *draw.shader;
+            const MeshletCuller culler(shader.uniforms.projection * shader.uniforms.modelView,
+                                       draw.occluders, draw.occluderClip);
+            const auto meshlets = draw.model->getMeshlets();
+            std::uint8_t* visible = &scratch.visible[scratch.firstMeshlet[d]];
+
+            for (int m = first; m < last; ++m) {
+                visible[m] = culler.isVisible(meshlets[m]);
+                chunkCulled += !visible[m];
+            }
+        }
+        culled.fetch_add(chunkCulled, std::memory_order_relaxed);
+    });
 
-        const Vec3f& p0 = pt.varyings[0].screenPos;
-        const Vec3f& p1 = pt.varyings[1].screenPos;
-        const Vec3f& p2 = pt.varyings[2].screenPos;
+    return culled.load(std::memory_order_relaxed);
+}
+
+// Clip positions of the visible meshlets' vertices into scratch.clips, one parallel loop
+// over all the draws. Vertices outside those ranges are left as they were.
+inline void transformDraws(const std::vector<DrawCall>& draws, GeometryScratch& scratch)
+{
+    const int numDraws = static_cast<int>(draws.size());
+
+    // Instances of one mesh back to back.
+    auto& order = scratch.order;
+    order.resize(numDraws);
+    for (int i = 0; i < numDraws; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&draws](const int a, const int b) {
+        return std::less<const ModelLoader*>()(draws[a].model, draws[b].model);
+    });
+
+    scratch.firstVertex.resize(numDraws);
+    int numVertices = 0;
+    for (int d = 0; d < numDraws; ++d) {
+        scratch.firstVertex[d] = numVertices;
+        numVertices += draws[d].model->getVertexStreams().size();
+    }
 
-        const float signedArea = (p1.x() - p0.x()) * (p2.y() - p0.y()) - (p1.y() - p0.y()) * (p2.x() - p0.x());
+    // Only grows, so the allocation is kept across frames.
+    ClipPositions& clips = scratch.clips;
+    if (static_cast<int>(clips.x.size()) < numVertices) {
+        clips.x.resize(numVertices);
+        clips.y.resize(numVertices);
+        clips.z.resize(numVertices);
+        clips.w.resize(numVertices);
+    }
 
-        if (signedArea > 0.0f) {
-            processed.push_back(pt);
+    // (draw, first vertex, end vertex) of at most TRANSFORM_GRAIN vertices, covering
+    // the union of the visible meshlets' ranges.
+    auto& batches = scratch.batches;
+    batches.clear();
+    for (const int d : order) {
+        const auto meshlets = draws[d].model->getMeshlets();
+        const std::uint8_t* visible = &scratch.visible[scratch.firstMeshlet[d]];
+
+        auto& ranges = scratch.ranges;
+        ranges.clear();
+        for (size_t m = 0; m < meshlets.size(); ++m) {
+            if (!visible[m]) continue;
+            for (int r = 0; r < meshlets[m].vertexRangeCount; ++r) {
+                const VertexRange& range = meshlets[m].vertexRanges[r];
+                ranges.emplace_back(range.begin, range.end);
+            }
+        }
+        // Mostly sorted already, vertices are numbered in meshlet order.
+        std::sort(ranges.begin(), ranges.end());
+
+        for (size_t r = 0; r < ranges.size();) {
+            const int first = ranges[r].first;
+            int end = ranges[r].second;
+            for (++r; r < ranges.size() && ranges[r].first <= end; ++r) end = std::max(end, ranges[r].second);
+
+            for (int batch = first; batch < end; batch += TRANSFORM_GRAIN) {
+                batches.push_back({ d, batch, std::min(batch + TRANSFORM_GRAIN, end) });
+            }
         }
     }
+
+    parallelFor(0, static_cast<int>(batches.size()), 1, [&](const int begin, const int end) {
+        for (int b = begin; b < end; ++b) {
+            const auto [d, first, last] = batches[b];
+            const IShader& shader = *draws[d].shader;
+            transformVertices(draws[d].model->getVertexStreams(), shader.uniforms.projection * shader.uniforms.modelView,
+                              clips, first, last, scratch.firstVertex[d]);
+        }
+    });
+}
+
+inline std::vector<ProcessedTriangle> preProcessVertices(const DrawCall& draw, const GeometryScratch& scratch,
+                                                         const int drawIdx)
+{
+    const ModelLoader& model = *draw.model;
+    IShader& shader = *draw.shader;
+    const Matrix4f4& viewport = shader.uniforms.viewport;
+    const auto& faces = model.getFaces();
+    const auto& tangents = model.getTangents();
+    const auto& meshlets = model.getMeshlets();
+    const int numMeshlets = static_cast<int>(meshlets.size());
+    const int numChunks = (numMeshlets + MESHLET_GRAIN - 1) / MESHLET_GRAIN;
+
+    const ClipPositions& clips = scratch.clips;
+    const int firstVertex = scratch.firstVertex[drawIdx];
+    const std::uint8_t* visible = &scratch.visible[scratch.firstMeshlet[drawIdx]];
+
+    // Each chunk collects into its own list, concatenated in order afterwards.
+    std::vector<std::vector<ProcessedTriangle>> chunks(numChunks);
+
+    parallelFor(0, numMeshlets, MESHLET_GRAIN, [&](const int begin, const int end) {
+        auto& processed = chunks[begin / MESHLET_GRAIN];
+        processed.reserve((end - begin) * MESHLET_SIZE);
+
+        for (int m = begin; m < end; ++m) {
+            if (!visible[m]) continue;
+
+            const Meshlet& meshlet = meshlets[m];
+            for (int f = meshlet.firstFace; f < meshlet.firstFace + meshlet.faceCount; ++f) {
+                const auto& face = faces[f];
+
+                // Back faces are rejected from the positions alone, before any shading.
+                Vec4f clip[3];
+                Vec3f screen[3];
+                for (int j = 0; j < 3; j++) {
+                    float invW;
+                    clip[j] = clips.at(firstVertex + face.vertexIndices[j]);
+                    screen[j] = IShader::toScreen(viewport, clip[j], invW);
+                }
+
+                const Vec3f& p0 = screen[0];
+                const Vec3f& p1 = screen[1];
+                const Vec3f& p2 = screen[2];
+
+                const float signedArea = (p1.x() - p0.x()) * (p2.y() - p0.y()) - (p1.y() - p0.y()) * (p2.x() - p0.x());
+                if (!(signedArea > 0.0f)) continue;
+
+                const TangentBasis& basis = tangents[f];
+
+                ProcessedTriangle pt;
+                for (int j = 0; j < 3; j++) {
+                    pt.varyings[j] = shader.vertex(clip[j], face.pts[j], face.normals[j], face.uv[j],
+                                                   basis.tangent, basis.bitangent);
+                }
+                processed.push_back(pt);
+            }
+        }
+    });
+
+    if (numChunks == 1) return std::move(chunks.front());
+
+    std::vector<ProcessedTriangle> processed;
+    size_t total = 0;
+    for (const auto& chunk : chunks) total += chunk.size();
+    processed.reserve(total);
+    for (const auto& chunk : chunks) processed.insert(processed.end(), chunk.begin(), chunk.end());
     return processed;
 }
 
-inline std::vector<Tile> binTrianglesToTiles(const std::vector<ProcessedTriangle>& triangles,
-                                             int width,
-                                             int height,
+// Range of tiles covered by a triangle's screen bounding box.
+struct TileRect {
+    int minTx, minTy, maxTx, maxTy;
+};
+
+inline std::vector<Tile> binTrianglesToTiles(const std::vector<std::vector<ProcessedTriangle>>& draws,
                                              const int numTilesX,
                                              const int numTilesY)
 {
-    std::vector<Tile> tiles(numTilesX * numTilesY);
-
-    for (size_t i = 0; i < triangles.size(); ++i) {
-        Vec3f screenPts[3] = { triangles[i].varyings[0].screenPos,
-                               triangles[i].varyings[1].screenPos,
-                               triangles[i].varyings[2].screenPos };
-        BBox bbox = computeTriangleBBox(screenPts);
-
-        const int minTx = std::max(0, (int)(bbox._boxMin.x() / TILE_SIZE));
-        const int maxTx = std::min(numTilesX - 1, (int)(bbox._boxMax.x() / TILE_SIZE));
-        const int minTy = std::max(0, (int)(bbox._boxMin.y() / TILE_SIZE));
-        const int maxTy = std::min(numTilesY - 1, (int)(bbox._boxMax.y() / TILE_SIZE));
+    size_t total = 0;
+    for (const auto& draw : draws) total += draw.size();
 
-        for (int ty = minTy; ty <= maxTy; ++ty) {
-            for (int tx = minTx; tx <= maxTx; ++tx) {
-                tiles[ty * numTilesX + tx].triangleIndices.push_back(i);
+    std::vector<TriangleRef> refs;
+    refs.reserve(total);
+    for (int d = 0; d < static_cast<int>(draws.size()); ++d) {
+        for (int i = 0; i < static_cast<int>(draws[d].size()); ++i) refs.push_back({d, i});
+    }
+    const int numTriangles = static_cast<int>(refs.size());
+    const int numTiles = numTilesX * numTilesY;
+
+    // Chunks of submission order, at most a few per worker so the per chunk counts stay small.
+    const int maxChunks = 4 * static_cast<int>(ThreadPool::instance().size());
+    const int chunkSize = std::max(BINNING_GRAIN, (numTriangles + maxChunks - 1) / maxChunks);
+    const int numChunks = std::max(1, (numTriangles + chunkSize - 1) / chunkSize);
+
+    // Pass 1: the tiles each triangle covers, counted per chunk and tile.
+    std::vector<TileRect> rects(numTriangles);
+    std::vector<int> slots(static_cast<size_t>(numChunks) * numTiles, 0);
+    parallelFor(0, numTriangles, chunkSize, [&](const int begin, const int end) {
+        int* counts = &slots[static_cast<size_t>(begin / chunkSize) * numTiles];
+        for (int r = begin; r < end; ++r) {
+            const auto& triangle = draws[refs[r].draw][refs[r].triangle];
+            Vec3f screenPts[3] = { triangle.varyings[0].screenPos,
+                                   triangle.varyings[1].screenPos,
+                                   triangle.varyings[2].screenPos };
+            BBox bbox = computeTriangleBBox(screenPts);
+
+            rects[r] = { std::max(0, (int)(bbox._boxMin.x() / TILE_SIZE)),
+                         std::max(0, (int)(bbox._boxMin.y() / TILE_SIZE)),
+                         std::min(numTilesX - 1, (int)(bbox._boxMax.x() / TILE_SIZE)),
+                         std::min(numTilesY - 1, (int)(bbox._boxMax.y() / TILE_SIZE)) };
+            for (int ty = rects[r].minTy; ty <= rects[r].maxTy; ++ty) {
+                for (int tx = rects[r].minTx; tx <= rects[r].maxTx; ++tx) counts[ty * numTilesX + tx]++;
             }
         }
+    });
+
+    // Each chunk's counts become the first slot it writes in every tile, chunks in submission order.
+    std::vector<Tile> tiles(numTiles);
+    for (int t = 0; t < numTiles; ++t) {
+        int offset = 0;
+        for (int c = 0; c < numChunks; ++c) {
+            int& slot = slots[static_cast<size_t>(c) * numTiles + t];
+            const int count = slot;
+            slot = offset;
+            offset += count;
+        }
+        tiles[t].triangles.resize(offset);
     }
+
+    // Pass 2: every chunk fills its own slots, so the tiles keep submission order without locking.
+    parallelFor(0, numTriangles, chunkSize, [&](const int begin, const int end) {
+        int* next = &slots[static_cast<size_t>(begin / chunkSize) * numTiles];
+        for (int r = begin; r < end; ++r) {
+            const TileRect& rect = rects[r];
+            for (int ty = rect.minTy; ty <= rect.maxTy; ++ty) {
+                for (int tx = rect.minTx; tx <= rect.maxTx; ++tx) {
+                    const int t = ty * numTilesX + tx;
+                    tiles[t].triangles[next[t]++] = refs[r];
+                }
+            }
+        }
+    });
     return tiles;
 }
 
-inline void tileWorker(std::atomic<int>& nextTileIndex,
-                       const int totalTiles,
-                       const std::vector<Tile>& tiles,
-                       const std::vector<ProcessedTriangle>& processedTriangles,
-                       IShader& shader,
-                       const RenderContext& ctx,
-                       const int numTilesX)
+inline void rasterizeTile(const int tileIdx,
+                          const Tile& tile,
+                          const std::vector<std::vector<ProcessedTriangle>>& processedTriangles,
+                          const std::vector<DrawCall>& draws,
+                          const RenderContext& ctx,
+                          const int numTilesX)
 {
-    int tileIdx;
-    while ((tileIdx = nextTileIndex.fetch_add(1)) < totalTiles) {
-        const auto& tile = tiles[tileIdx];
-        if (tile.triangleIndices.empty()) continue;
+    // One block per worker thread, reused for every tile it processes.
+    thread_local TileBuffer tileBuffer;
 
-        const int tx = tileIdx % numTilesX;
-        const int ty = tileIdx / numTilesX;
-        const int minX = tx * TILE_SIZE;
-        const int minY = ty * TILE_SIZE;
-        const int maxX = std::min(minX + TILE_SIZE - 1, ctx.width - 1);
-        const int maxY = std::min(minY + TILE_SIZE - 1, ctx.height - 1);
+    const int tx = tileIdx % numTilesX;
+    const int ty = tileIdx / numTilesX;
+    tileBuffer.minX = tx * TILE_SIZE;
+    tileBuffer.minY = ty * TILE_SIZE;
+    tileBuffer.maxX = std::min(tileBuffer.minX + TILE_SIZE - 1, ctx.width - 1);
+    tileBuffer.maxY = std::min(tileBuffer.minY + TILE_SIZE - 1, ctx.height - 1);
 
-        for (const int triIdx : tile.triangleIndices) {
-            drawTriangleClipped(processedTriangles[triIdx].varyings, shader, ctx,
-                         minX, minY, maxX, maxY);
-        }
+    loadTile(ctx, tileIdx, tileBuffer);
+
+    for (const auto& [drawIdx, triIdx] : tile.triangles) {
+        drawTriangleClipped(processedTriangles[drawIdx][triIdx].varyings, *draws[drawIdx].shader, ctx,
+                            tileBuffer);
     }
+
+    flushTile(ctx, tileIdx, tileBuffer);
 }
 
-void drawModel(const RenderContext &ctx, IShader& shader)
+BinnedGeometry processGeometry(const std::vector<DrawCall>& draws, const int width, const int height,
+                               GeometryScratch& scratch)
 {
-    const int numTilesX = (ctx.width + TILE_SIZE - 1) / TILE_SIZE;
-    const int numTilesY = (ctx.height + TILE_SIZE - 1) / TILE_SIZE;
+    BinnedGeometry geometry;
+    geometry.draws = draws;
+    geometry.numTilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    geometry.numTilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    geometry.culledMeshlets = cullMeshlets(draws, scratch);
+    transformDraws(draws, scratch);
+
+    geometry.triangles.reserve(draws.size());
+    for (int i = 0; i < static_cast<int>(draws.size()); ++i) {
+        geometry.meshlets += static_cast<int>(draws[i].model->getMeshlets().size());
+        geometry.triangles.push_back(preProcessVertices(draws[i], scratch, i));
+    }
 
-    const auto processedTriangles = preProcessVertices(ctx.model, shader);
-    const auto tiles = binTrianglesToTiles(processedTriangles,
-                                                      ctx.width,
-                                                      ctx.height,
-                                                      numTilesX,
-                                                      numTilesY);
+    geometry.tiles = binTrianglesToTiles(geometry.triangles, geometry.numTilesX, geometry.numTilesY);
+    return geometry;
+}
 
-    std::atomic<int> nextTileIndex{0};
-    const unsigned int numThreads = std::max(1u, std::thread::hardware_concurrency());
+void rasterizeGeometry(const RenderContext &ctx, const BinnedGeometry& geometry)
+{
+    const auto& tiles = geometry.tiles;
 
-    for (unsigned int t = 0; t < numThreads; ++t) {
-        ThreadPool::instance().enqueue([&, t]() {
-            tileWorker(std::ref(nextTileIndex),
-                     static_cast<int>(tiles.size()),
-                     std::cref(tiles),
-          std::cref(processedTriangles),
-                 std::ref(shader),
-                      std::cref(ctx), numTilesX);
-        });
-    }
+    parallelFor(0, static_cast<int>(tiles.size()), 1, [&](const int begin, const int end) {
+        for (int tileIdx = begin; tileIdx < end; ++tileIdx) {
+            if (tiles[tileIdx].triangles.empty()) continue;
+            rasterizeTile(tileIdx, tiles[tileIdx], geometry.triangles, geometry.draws, ctx, geometry.numTilesX);
+        }
+    });
+}
 
-    ThreadPool::instance().waitFinished();
-}
\ No newline at end of file
+void drawModels(const RenderContext &ctx, const std::vector<DrawCall>& draws)
+{
+    GeometryScratch scratch;
+    rasterizeGeometry(ctx, processGeometry(draws, ctx.width, ctx.height, scratch));
+}
+
+void drawModel(const RenderContext &ctx, const ModelLoader& model, IShader& shader)
+{
+    drawModels(ctx, { DrawCall{ &model, &shader } });
+}
+
+void resolveUntouchedTiles(const RenderContext &ctx)
+{
+    TileClearState& state = *ctx.clearState;
+    const int totalTiles = state.numTilesX * state.numTilesY;
+
+    parallelFor(0, totalTiles, 4, [&](const int begin, const int end) {
+        for (int tileIdx = begin; tileIdx < end; ++tileIdx) {
+            if (!state.needsClear(tileIdx)) continue;
+
+            const int minX = (tileIdx % state.numTilesX) * TILE_SIZE;
+            const int minY = (tileIdx / state.numTilesX) * TILE_SIZE;
+            const int maxX = std::min(minX + TILE_SIZE - 1, ctx.width - 1);
+            const int maxY = std::min(minY + TILE_SIZE - 1, ctx.height - 1);
+
+            clearTile(ctx, minX, minY, maxX, maxY);
+            state.markCleared(tileIdx);
+        }
+    });
+}
@@ -5,18 +5,140 @@
 #include "../IO/tgaimage.h"
 #include "../IO/ModelLoader.h"
 #include "IShader.h"
+#include "PixelFormat.h"
+#include "../Math/Frustum.h"
+#include "DepthPyramid.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+constexpr int TILE_SIZE = 32;
+constexpr float DEPTH_CLEAR_VALUE = -std::numeric_limits<float>::max();
+
+/**
+ * Tracks which tiles of a render target were already cleared this frame.
+ * Instead of clearing the whole target up front, the frame generation is
+ * bumped and every tile whose generation is stale still holds last frame's data.
+ * A tile is cleared by the first worker that touches it, tiles that no
+ * triangle covered are resolved to the clear value once the pass is done.
+ */
+struct TileClearState {
+    std::vector<std::uint32_t> tileGeneration;
+    std::uint32_t generation = 1;
+    int numTilesX = 0;
+    int numTilesY = 0;
+
+    TileClearState(const int width, const int height)
+        : numTilesX((width + TILE_SIZE - 1) / TILE_SIZE),
+          numTilesY((height + TILE_SIZE - 1) / TILE_SIZE)
+    {
+        // Buffers are allocated uninitialized, so every tile starts stale.
+        tileGeneration.assign(numTilesX * numTilesY, 0);
+    }
+
+    // Marks every tile as stale, O(1) instead of touching the buffers.
+    void invalidate()
+    {
+        if (++generation == 0) {
+            std::ranges::fill(tileGeneration, 0);
+            generation = 1;
+        }
+    }
+
+    [[nodiscard]] bool needsClear(const int tileIdx) const { return tileGeneration[tileIdx] != generation; }
+    void markCleared(const int tileIdx) { tileGeneration[tileIdx] = generation; }
+};
 
 /**
- * Contains the context of the scene as well as the model to
- * be rendered.
+ * Contains the target buffers the models are rendered into.
+ * Color and normal buffers are optional (e.g. the shadow pass).
  */
 struct RenderContext {
-    const ModelLoader &model;
-    std::vector<float>& zbuffer;
-    std::vector<unsigned char>* colorBuffer = nullptr;
-    std::vector<Vec3f>* normalBuffer = nullptr;
+    AlignedVector<float>& zbuffer;
+    AlignedVector<std::uint32_t>* colorBuffer = nullptr;
+    AlignedVector<Vec3f>* normalBuffer = nullptr;
     int width = 0;
     int height = 0;
+    TileClearState* clearState = nullptr;
+    PixelFormat colorFormat = PixelFormat::RGBA8;
+};
+
+/**
+ * A single model submitted to a pass together with the shader to draw it.
+ * With occluders set, meshlets hidden behind their depth are skipped too.
+ */
+struct DrawCall {
+    const ModelLoader* model;
+    IShader* shader;
+    const DepthPyramid* occluders = nullptr;
+    Matrix4f4 occluderClip = Matrix4f4::identity();    // model space to the occluders' clip space.
+};
+
+// Vertex shader output of a triangle that survived backface culling.
+struct ProcessedTriangle {
+    Varyings varyings[3];
+};
+
+struct TriangleRef {
+    int draw;
+    int triangle;
+};
+
+// Triangles overlapping the tile, in submission order.
+struct Tile {
+    std::vector<TriangleRef> triangles;
+};
+
+/**
+ * Output of the geometry stage of a pass: the processed triangles of
+ * every draw and their tile bins. Only depends on the draws and the
+ * target size, not on the target contents, so it can be built while
+ * another pass is still rasterizing.
+ */
+struct BinnedGeometry {
+    std::vector<DrawCall> draws;
+    std::vector<std::vector<ProcessedTriangle>> triangles;
+    std::vector<Tile> tiles;
+    int numTilesX = 0;
+    int numTilesY = 0;
+    int meshlets = 0;
+    int culledMeshlets = 0;
+};
+
+/**
+ * Rejects whole meshlets of a draw before their vertices are processed -
+ * meshlets outside the view frustum, meshlets whose faces all face away,
+ * and, given a depth pyramid, meshlets behind it.
+ * Works in model space from the draw's clip transform, so it never rejects
+ * a meshlet that has a triangle the rasterizer would keep.
+ */
+class MeshletCuller {
+public:
+    /**
+     * @param clip - Model to clip space transform of the draw,
+     *               uniforms.projection * uniforms.modelView for the shaders here.
+     */
+    explicit MeshletCuller(const Matrix4f4& clip);
+
+    /**
+     * @param clip - See above.
+     * @param occluders - Depth to test against, may be null.
+     * @param occluderClip - Model space to the occluders' clip space.
+     */
+    MeshletCuller(const Matrix4f4& clip, const DepthPyramid* occluders, const Matrix4f4& occluderClip);
+
+    [[nodiscard]] bool isVisible(const Meshlet& meshlet) const;
+
+private:
+    [[nodiscard]] bool isFrontFacing(const Meshlet& meshlet) const;
+
+    const DepthPyramid* occluders = nullptr;
+    Matrix4f4 occluderClip;
+    Frustum frustum;
+    Vec4f clipW;                // w row of the clip transform.
+    Vec4f eye;                  // homogeneous viewpoint in model space.
 };
 
 
@@ -44,30 +166,108 @@ BBox computeTriangleBBox(const Vec3f pts[3]);
 
 
 /**
- * @brief Draws the model given its context and a shader.
+ * @brief Draws all the models of a pass given the target context.
  *        The function uses multi-threading tiles approach -
- *        1. The framebuffer is divided into tiles sized 32x32 pixels.
- *        2. Each thread works on a single tile until finished.
- *        3. The thread process the next tile available.
+ *        1. The triangles of every draw are binned into tiles sized 32x32 pixels.
+ *        2. Each thread works on a single tile until finished, rasterizing
+ *           all the tile's triangles into a tile-local block.
+ *        3. The tile is flushed to the target once and the thread
+ *           process the next tile available.
  *        4. All tiles marked finished.
  *
- * @param ctx                                       The scene context.
+ * @param ctx                                      The target context.
+ * @param draws          Models and shaders, drawn in submission order.
+ */
+void drawModels(const RenderContext &ctx, const std::vector<DrawCall>& draws);
+
+
+/**
+ * Clip space positions of a mesh's vertices under one instance's transform,
+ * SoA like VertexStreams and indexed the same way.
+ */
+struct ClipPositions {
+    AlignedVector<float> x;
+    AlignedVector<float> y;
+    AlignedVector<float> z;
+    AlignedVector<float> w;
+
+    [[nodiscard]] Vec4f at(const int i) const { return Vec4f(x[i], y[i], z[i], w[i]); }
+};
+
+
+/**
+ * @brief Transforms vertices [begin, end) of a mesh to clip space. The loop runs
+ *        over plain float arrays, so it compiles to SIMD batches of vertices.
+ *        Sums in the same order as Matrix * Vec, so results match it exactly.
+ *
+ * @param streams                      The mesh's vertex positions.
+ * @param clip               Model to clip space transform of the instance.
+ * @param out      Sized by the caller, written in [offset + begin, offset + end).
+ * @param offset              Where the mesh's vertex 0 goes in out.
+ */
+void transformVertices(const VertexStreams& streams, const Matrix4f4& clip, ClipPositions& out,
+                       int begin, int end, int offset = 0);
+
+
+/**
+ * Working memory of processGeometry, kept by the caller so it is reused
+ * from frame to frame instead of allocated per draw.
+ */
+struct GeometryScratch {
+    // Clip positions of all the draws back to back, only the vertices of visible meshlets are written.
+    ClipPositions clips;
+    std::vector<int> firstVertex;           // of each draw in clips.
+    std::vector<std::uint8_t> visible;      // per meshlet of all the draws back to back.
+    std::vector<int> firstMeshlet;          // of each draw in visible.
+    std::vector<int> order;                 // draws, instances of a mesh back to back.
+    std::vector<std::pair<int, int>> ranges;  // vertex ranges of one draw's visible meshlets.
+    std::vector<std::array<int, 3>> batches;  // (draw, begin, end) of the culling, then the transform tasks.
+};
+
+
+/**
+ * @brief Geometry stage of drawModels - vertex processing, culling and binning.
+ *        Meshlets are culled first, then only the vertex ranges of the ones
+ *        left are transformed, for all the draws in one go, the instances of
+ *        a mesh back to back so its vertex streams stay in cache.
+ *
+ * @param draws          Models and shaders, drawn in submission order.
+ * @param width                           Target width in pixels.
+ * @param height                         Target height in pixels.
+ * @param scratch       Reused between calls, one per concurrent call.
+ * @return                      The binned triangles of all draws.
+ */
+BinnedGeometry processGeometry(const std::vector<DrawCall>& draws, int width, int height,
+                               GeometryScratch& scratch);
+
+
+/**
+ * @brief Raster stage of drawModels - rasterizes the binned triangles tile by tile.
+ *
+ * @param ctx          The target context, same size the geometry was binned for.
+ * @param geometry                        Output of processGeometry.
+ */
+void rasterizeGeometry(const RenderContext &ctx, const BinnedGeometry& geometry);
+
+
+/**
+ * @brief Draws a single model, see drawModels.
+ *
+ * @param ctx                                       The target context.
+ * @param model                                     The model to draw.
  * @param shader                      How to draw the pixel correctly.
  */
-void drawModel(const RenderContext &ctx, IShader& shader);
+void drawModel(const RenderContext &ctx, const ModelLoader& model, IShader& shader);
 
 
 /**
- * @brief                    Calculates the TBN basis for a triangle.
- *               The calculation requires both the triangle vertices
- *                            and the UV coordinates for each vertex.
- *            The TBN matrix is used for correct normal calculations
- *                                     as well as correct UV mapping.
+ * @brief Writes the clear value into every tile that no worker touched
+ *        since the last TileClearState::invalidate().
+ *        Must run after the last drawModel of a pass and before anyone
+ *        reads the target (shadow lookups, SSAO, presentation).
  *
- * @param pts                                    Triangle 3 vertices.
- * @param uvs                              Triangle 3 UV coordinates.
- * @return                     Returns the new tangent and bitangent.
+ * @param ctx            The target context, must have a clearState.
  */
-std::pair<Vec3f, Vec3f> calculateTriangleBasis(const Vec3f pts[3], const Vec2f uvs[3]);
+void resolveUntouchedTiles(const RenderContext &ctx);
 
 #endif //RENDERER_RASTERIZER_H
@@ -0,0 +1,101 @@
+#include "ResourceLoader.h"
+
+#include <atomic>
+
+struct ResourceLoader::Job {
+    Ticket ticket = 0;
+    std::string key;
+    std::string paths[4];                               // OBJ, diffuse, normal and specular map.
+
+    std::shared_ptr<const MeshCacheData> mesh;
+    std::shared_ptr<const TGAImage> textures[3];
+    std::atomic<int> remaining = 4;
+};
+
+ResourceLoader::ResourceLoader(ResourceManager& assets, const size_t threads) : assets(assets), pool(threads) {}
+
+ResourceLoader::~ResourceLoader()
+{
+    pool.waitFinished();
+}
+
+ResourceLoader::Ticket ResourceLoader::load(const std::string& modelRoot, const std::string& objPath,
+                                            const std::string& diffPath, const std::string& nmPath,
+                                            const std::string& specPath)
+{
+    const std::string key = modelRoot + objPath;
+    if (const auto it = loading.find(key); it != loading.end()) return it->second;
+
+    auto job = std::make_shared<Job>();
+    job->ticket = nextTicket++;
+    job->key = key;
+    job->paths[0] = key;
+    job->paths[1] = modelRoot + diffPath;
+    job->paths[2] = modelRoot + nmPath;
+    job->paths[3] = modelRoot + specPath;
+    loading.emplace(key, job->ticket);
+
+    pool.enqueue([this, job] {
+        job->mesh = assets.loadMesh(job->paths[0], pool);
+        finishPart(job);
+    });
+    for (int i = 0; i < 3; ++i) {
+        pool.enqueue([this, job, i] {
+            job->textures[i] = assets.loadTexture(job->paths[i + 1]);
+            finishPart(job);
+        });
+    }
+
+    return job->ticket;
+}
+
+void ResourceLoader::finishPart(const std::shared_ptr<Job>& job)
+{
+    // The last part assembles the resource, the others' writes are visible through the acq_rel.
+    if (job->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+    auto resource = std::make_shared<ModelResource>(std::move(job->mesh), std::move(job->textures[0]),
+                                                    std::move(job->textures[1]), std::move(job->textures[2]));
+
+    std::lock_guard<std::mutex> lock(finishedMutex);
+    finished.push_back({ job->ticket, job->key, std::move(resource) });
+}
+
+std::vector<ResourceLoader::Loaded> ResourceLoader::poll()
+{
+    std::vector<Loaded> done;
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        done.swap(finished);
+    }
+
+    for (const auto& loaded : done) loading.erase(loaded.key);
+    return done;
+}
+
+std::shared_ptr<ModelResource> ResourceLoader::placeholder()
+{
+    static const std::shared_ptr<ModelResource> cube = [] {
+        std::vector<Point3> vertices;
+        for (int i = 0; i < 8; ++i) {
+            vertices.emplace_back((i >> 2 & 1) - 0.5f, (i >> 1 & 1) - 0.5f, (i & 1) - 0.5f);
+        }
+
+        // Counter-clockwise seen from outside, +x -x +y -y +z -z.
+        constexpr int QUADS[6][4] = {
+            { 4, 6, 7, 5 }, { 0, 1, 3, 2 }, { 2, 3, 7, 6 }, { 0, 4, 5, 1 }, { 1, 5, 7, 3 }, { 0, 2, 6, 4 }
+        };
+        constexpr int NONE[3] = { -1, -1, -1 };
+
+        std::vector<Face> faces;
+        for (const auto& quad : QUADS) {
+            const int first[3] = { quad[0], quad[1], quad[2] };
+            const int second[3] = { quad[0], quad[2], quad[3] };
+            faces.emplace_back(first, NONE, NONE);
+            faces.emplace_back(second, NONE, NONE);
+        }
+
+        return std::make_shared<ModelResource>(ModelLoader(std::move(vertices), {}, {}, std::move(faces)));
+    }();
+    return cube;
+}
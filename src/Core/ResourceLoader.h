@@ -0,0 +1,78 @@
+#ifndef RENDERER_RESOURCELOADER_H
+#define RENDERER_RESOURCELOADER_H
+
+#include "ResourceManager.h"
+#include "../Utils/ThreadPool.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Loads textured ModelResources in the background, so adding a model never
+ * stalls the UI thread or the frame. The mesh and the three textures of a
+ * resource are decoded side by side on the loader's own workers, and so are
+ * the chunks of a mesh parse - nothing runs on the shared pool the renderer
+ * uses, or on a render thread waiting for it. Finished resources
+ * are collected with poll() by the thread that owns the scene, which swaps
+ * them in for their placeholders before the next snapshot is published.
+ * Meshes and textures come from a ResourceManager, so the ones already in
+ * memory are shared instead of loaded again.
+ */
+class ResourceLoader {
+public:
+    using Ticket = int;
+
+    struct Loaded {
+        Ticket ticket;
+        std::string key;                            // folder + OBJ file, as given to load().
+        std::shared_ptr<ModelResource> resource;
+    };
+
+    // assets must outlive the loader.
+    explicit ResourceLoader(ResourceManager& assets, size_t threads = DEFAULT_THREADS);
+
+    // Waits for the loads in flight.
+    ~ResourceLoader();
+
+    ResourceLoader(const ResourceLoader&) = delete;
+    ResourceLoader& operator=(const ResourceLoader&) = delete;
+
+    /**
+     * @brief Starts loading a resource and returns at once. Loading a resource
+     *        that is still on its way joins that load instead of starting another.
+     *
+     * @return                           Identifies the load in poll().
+     */
+    Ticket load(const std::string& modelRoot, const std::string& objPath, const std::string& diffPath,
+                const std::string& nmPath, const std::string& specPath);
+
+    // Loads finished since the last call, in the order they finished.
+    std::vector<Loaded> poll();
+
+    // Loads started and not returned by poll() yet.
+    [[nodiscard]] int pending() const { return static_cast<int>(loading.size()); }
+
+    // Stands in for a resource until it is loaded - an untextured unit cube, shared by every placeholder.
+    static std::shared_ptr<ModelResource> placeholder();
+
+    static constexpr size_t DEFAULT_THREADS = 4;        // a mesh and three textures.
+
+private:
+    struct Job;
+
+    void finishPart(const std::shared_ptr<Job>& job);
+
+    ResourceManager& assets;
+    std::map<std::string, Ticket> loading;              // used by the polling thread only.
+    Ticket nextTicket = 0;
+
+    std::mutex finishedMutex;
+    std::vector<Loaded> finished;
+
+    ThreadPool pool;                                    // last, so its workers stop first.
+};
+
+#endif //RENDERER_RESOURCELOADER_H
@@ -0,0 +1,131 @@
+#include "ResourceManager.h"
+
+#include <algorithm>
+
+namespace {
+    size_t meshBytes(const MeshCacheData& mesh)
+    {
+        size_t bytes = 0;
+        for (const auto& level : mesh.levels) {
+            bytes += level.getVertices().size_bytes() + level.getVerticesNormals().size_bytes() +
+                     level.getVerticesTexture().size_bytes() + level.getFaces().size_bytes() +
+                     level.getMeshlets().size_bytes() + level.getTangents().size_bytes() +
+                     3 * sizeof(float) * level.getVertexStreams().size();
+        }
+        return bytes;
+    }
+
+    size_t textureBytes(const TGAImage& image)
+    {
+        return image.buffer_size();
+    }
+}
+
+template <typename T, typename Load, typename Bytes>
+std::shared_ptr<const T> ResourceManager::loadShared(std::map<std::uint64_t, Asset<T>>& table,
+                                                     const std::string& path, const Load& load, const Bytes& bytes)
+{
+    // Unreadable files are not shared, they load as whatever load makes of them.
+    std::uint64_t hash;
+    if (!sourceContentHash(path, hash)) return load(path);
+
+    {
+        std::lock_guard<std::mutex> lock(assetsMutex);
+        if (const auto it = table.find(hash); it != table.end()) {
+            if (auto data = it->second.data.lock()) return data;
+        }
+    }
+
+    // Loaded outside the lock. Two loads of the same content racing each other
+    // both decode, the later one is dropped in favour of the first.
+    std::shared_ptr<const T> loaded = load(path);
+
+    std::lock_guard<std::mutex> lock(assetsMutex);
+    Asset<T>& asset = table[hash];
+    if (auto data = asset.data.lock()) return data;
+    asset.path = path;
+    asset.data = loaded;
+    asset.bytes = bytes(*loaded);
+    return loaded;
+}
+
+std::shared_ptr<const MeshCacheData> ResourceManager::loadMesh(const std::string& objPath, ThreadPool& pool)
+{
+    return loadShared(meshes, objPath, [&pool](const std::string& path) {
+        return std::make_shared<const MeshCacheData>(ModelResource::loadMesh(path, pool));
+    }, meshBytes);
+}
+
+std::shared_ptr<const TGAImage> ResourceManager::loadTexture(const std::string& path)
+{
+    return loadShared(textures, path, ModelResource::loadTexture, textureBytes);
+}
+
+std::shared_ptr<ModelResource> ResourceManager::find(const std::string& key)
+{
+    const auto it = resources.find(key);
+    if (it == resources.end()) return nullptr;
+
+    it->second.lastUsed = ++useCounter;
+    return it->second.resource;
+}
+
+void ResourceManager::add(const std::string& key, std::shared_ptr<ModelResource> resource)
+{
+    resources[key] = { std::move(resource), ++useCounter };
+}
+
+int ResourceManager::trim()
+{
+    int dropped = 0;
+    while (residentBytes() > budget) {
+        // Only this map holds an unused resource.
+        auto oldest = resources.end();
+        for (auto it = resources.begin(); it != resources.end(); ++it) {
+            if (it->second.resource.use_count() != 1) continue;
+            if (oldest == resources.end() || it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+        }
+        if (oldest == resources.end()) break;
+
+        resources.erase(oldest);
+        ++dropped;
+    }
+
+    // Assets whose last resource is gone.
+    std::lock_guard<std::mutex> lock(assetsMutex);
+    std::erase_if(meshes, [](const auto& entry) { return entry.second.data.expired(); });
+    std::erase_if(textures, [](const auto& entry) { return entry.second.data.expired(); });
+    return dropped;
+}
+
+size_t ResourceManager::residentBytes() const
+{
+    std::lock_guard<std::mutex> lock(assetsMutex);
+    size_t bytes = 0;
+    for (const auto& [hash, asset] : meshes) {
+        if (!asset.data.expired()) bytes += asset.bytes;
+    }
+    for (const auto& [hash, asset] : textures) {
+        if (!asset.data.expired()) bytes += asset.bytes;
+    }
+    return bytes;
+}
+
+std::vector<ResourceManager::AssetInfo> ResourceManager::report() const
+{
+    std::vector<AssetInfo> assets;
+    {
+        std::lock_guard<std::mutex> lock(assetsMutex);
+        for (const auto& [hash, asset] : meshes) {
+            const long references = asset.data.use_count();
+            if (references > 0) assets.push_back({ asset.path, false, asset.bytes, references });
+        }
+        for (const auto& [hash, asset] : textures) {
+            const long references = asset.data.use_count();
+            if (references > 0) assets.push_back({ asset.path, true, asset.bytes, references });
+        }
+    }
+
+    std::sort(assets.begin(), assets.end(), [](const AssetInfo& a, const AssetInfo& b) { return a.bytes > b.bytes; });
+    return assets;
+}
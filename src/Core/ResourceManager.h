@@ -0,0 +1,105 @@
+#ifndef RENDERER_RESOURCEMANAGER_H
+#define RENDERER_RESOURCEMANAGER_H
+
+#include "ModelInstance.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Owns the loaded ModelResources and the meshes and textures they are made of.
+ *
+ * Meshes and textures are deduplicated by the hash of their file content, so
+ * the same map under two names, or a model copied to another folder, is loaded
+ * and kept in memory once. Assets are held weakly and go away with the last
+ * resource using them.
+ *
+ * Resources are kept after their last instance is removed, so adding the model
+ * again is immediate, but only while the assets in memory fit the budget -
+ * beyond it the unused resources are dropped, least recently used first.
+ */
+class ResourceManager {
+public:
+    struct AssetInfo {
+        std::string path;                   // the file the asset was first loaded from.
+        bool isTexture;
+        size_t bytes;
+        long references;                    // maps and meshes of resources, and loads in flight.
+    };
+
+    explicit ResourceManager(size_t budgetBytes = DEFAULT_BUDGET) : budget(budgetBytes) {}
+
+    ResourceManager(const ResourceManager&) = delete;
+    ResourceManager& operator=(const ResourceManager&) = delete;
+
+    /**
+     * @brief Loads a mesh (see ModelResource::loadMesh) on pool, or returns
+     *        the one in memory with the same content. Safe to call from any thread.
+     */
+    std::shared_ptr<const MeshCacheData> loadMesh(const std::string& objPath,
+                                                  ThreadPool& pool = ThreadPool::instance());
+
+    /**
+     * @brief Loads a texture (see ModelResource::loadTexture), or returns the
+     *        one in memory with the same content. Safe to call from any thread.
+     */
+    std::shared_ptr<const TGAImage> loadTexture(const std::string& path);
+
+    // The resource added under key, nullptr if there is none. Marks it as used.
+    std::shared_ptr<ModelResource> find(const std::string& key);
+
+    // Adds or replaces the resource under key and marks it as used.
+    void add(const std::string& key, std::shared_ptr<ModelResource> resource);
+
+    /**
+     * @brief Drops unused resources, least recently used first, until the
+     *        assets in memory fit the budget. Resources still referenced by an
+     *        instance (or a scene snapshot) are never dropped, so the budget
+     *        can be exceeded by what the scene itself needs.
+     *
+     * @return                                   Number of resources dropped.
+     */
+    int trim();
+
+    // Bytes of all the meshes and textures in memory, each counted once however many resources share it.
+    [[nodiscard]] size_t residentBytes() const;
+
+    // Every mesh and texture in memory, largest first.
+    [[nodiscard]] std::vector<AssetInfo> report() const;
+
+    [[nodiscard]] size_t resourceCount() const { return resources.size(); }
+
+    size_t budget;
+
+    static constexpr size_t DEFAULT_BUDGET = size_t(1) << 30;
+
+private:
+    template <typename T>
+    struct Asset {
+        std::string path;
+        std::weak_ptr<const T> data;
+        size_t bytes = 0;
+    };
+
+    struct Entry {
+        std::shared_ptr<ModelResource> resource;
+        std::uint64_t lastUsed = 0;
+    };
+
+    template <typename T, typename Load, typename Bytes>
+    std::shared_ptr<const T> loadShared(std::map<std::uint64_t, Asset<T>>& table, const std::string& path,
+                                        const Load& load, const Bytes& bytes);
+
+    mutable std::mutex assetsMutex;         // guards meshes and textures, loads run on the loader's threads.
+    std::map<std::uint64_t, Asset<MeshCacheData>> meshes;
+    std::map<std::uint64_t, Asset<TGAImage>> textures;
+
+    std::map<std::string, Entry> resources; // used by the thread that owns the scene only.
+    std::uint64_t useCounter = 0;
+};
+
+#endif //RENDERER_RESOURCEMANAGER_H
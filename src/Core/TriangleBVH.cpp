@@ -0,0 +1,155 @@
+#include "TriangleBVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Distance along the ray where it enters the box, negative if it misses.
+    float rayEntry(const Vec3f& origin, const Vec3f& invDir, const Vec3f& min, const Vec3f& max, const float tMax)
+    {
+        float tNear = 0.0f;
+        float tFar = tMax;
+        for (int i = 0; i < 3; ++i) {
+            const float t1 = (min[i] - origin[i]) * invDir[i];
+            const float t2 = (max[i] - origin[i]) * invDir[i];
+            tNear = std::max(tNear, std::min(t1, t2));
+            tFar = std::min(tFar, std::max(t1, t2));
+        }
+        return tNear <= tFar ? tNear : -1.0f;
+    }
+}
+
+void TriangleBVH::build(const ModelLoader& mesh)
+{
+    const auto& faces = mesh.getFaces();
+    const int count = static_cast<int>(faces.size());
+
+    nodes.clear();
+    triangles.clear();
+    if (count == 0) return;
+
+    std::vector<int> order(count);
+    std::vector<Vec3f> centroids(count);
+    for (int i = 0; i < count; ++i) {
+        order[i] = i;
+        centroids[i] = (faces[i].pts[0] + faces[i].pts[1] + faces[i].pts[2]) * (1.0f / 3.0f);
+    }
+
+    nodes.reserve(2 * (count / LEAF_SIZE + 1));
+    nodes.emplace_back();
+    buildNode(0, 0, count, order, faces, centroids);
+
+    triangles.reserve(count);
+    for (const int face : order) {
+        const auto& pts = faces[face].pts;
+        triangles.push_back({ pts[0], pts[1] - pts[0], pts[2] - pts[0], face });
+    }
+}
+
+void TriangleBVH::buildNode(const int index, const int begin, const int end, std::vector<int>& order,
+                            std::span<const Face> faces, const std::vector<Vec3f>& centroids)
+{
+    Vec3f min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    Vec3f max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+    Vec3f centroidMin = min;
+    Vec3f centroidMax = max;
+
+    for (int k = begin; k < end; ++k) {
+        const int face = order[k];
+        for (int i = 0; i < 3; ++i) {
+            for (const auto& p : faces[face].pts) {
+                min[i] = std::min(min[i], p[i]);
+                max[i] = std::max(max[i], p[i]);
+            }
+            centroidMin[i] = std::min(centroidMin[i], centroids[face][i]);
+            centroidMax[i] = std::max(centroidMax[i], centroids[face][i]);
+        }
+    }
+
+    nodes[index].min = min;
+    nodes[index].max = max;
+
+    if (end - begin <= LEAF_SIZE) {
+        nodes[index].first = begin;
+        nodes[index].count = end - begin;
+        return;
+    }
+
+    // Median split along the longest axis of the centroids.
+    const Vec3f extent = centroidMax - centroidMin;
+    int axis = 0;
+    if (extent[1] > extent[axis]) axis = 1;
+    if (extent[2] > extent[axis]) axis = 2;
+
+    const int mid = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                     [&centroids, axis](const int a, const int b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    const int left = static_cast<int>(nodes.size());
+    nodes.emplace_back();
+    nodes.emplace_back();
+    nodes[index].first = left;
+    nodes[index].count = 0;
+
+    buildNode(left, begin, mid, order, faces, centroids);
+    buildNode(left + 1, mid, end, order, faces, centroids);
+}
+
+bool TriangleBVH::raycast(const Vec3f& origin, const Vec3f& dir, Hit& hit) const
+{
+    if (nodes.empty()) return false;
+
+    const Vec3f invDir(1.0f / dir.x(), 1.0f / dir.y(), 1.0f / dir.z());
+    bool found = false;
+
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (rayEntry(origin, invDir, node.min, node.max, hit.t) < 0.0f) continue;
+
+        if (node.count > 0) {
+            // Moller-Trumbore, without culling either side.
+            for (int k = node.first; k < node.first + node.count; ++k) {
+                const Triangle& tri = triangles[k];
+                const Vec3f p = cross(dir, tri.e2);
+                const float det = dotProduct(tri.e1, p);
+                if (std::abs(det) < std::numeric_limits<float>::min()) continue;
+
+                const float invDet = 1.0f / det;
+                const Vec3f s = origin - tri.v0;
+                const float u = dotProduct(s, p) * invDet;
+                if (u < 0.0f || u > 1.0f) continue;
+
+                const Vec3f q = cross(s, tri.e1);
+                const float v = dotProduct(dir, q) * invDet;
+                if (v < 0.0f || u + v > 1.0f) continue;
+
+                const float t = dotProduct(tri.e2, q) * invDet;
+                if (t < 0.0f || t >= hit.t) continue;
+
+                hit = { t, tri.face, u, v };
+                found = true;
+            }
+            continue;
+        }
+
+        // Visit the nearer child first, so the farther one is often skipped.
+        const int a = node.first;
+        const int b = node.first + 1;
+        const float entryA = rayEntry(origin, invDir, nodes[a].min, nodes[a].max, hit.t);
+        const float entryB = rayEntry(origin, invDir, nodes[b].min, nodes[b].max, hit.t);
+        if (entryA >= 0.0f && entryB >= 0.0f) {
+            stack[top++] = entryA <= entryB ? b : a;
+            stack[top++] = entryA <= entryB ? a : b;
+        } else if (entryA >= 0.0f) {
+            stack[top++] = a;
+        } else if (entryB >= 0.0f) {
+            stack[top++] = b;
+        }
+    }
+
+    return found;
+}
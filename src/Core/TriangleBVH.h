@@ -0,0 +1,70 @@
+#ifndef RENDERER_TRIANGLEBVH_H
+#define RENDERER_TRIANGLEBVH_H
+
+#include "../IO/ModelLoader.h"
+#include <limits>
+#include <vector>
+
+/**
+ * Bounding volume hierarchy over the faces of one mesh, in model space.
+ * Built once per ModelResource and shared by all its instances - a ray is
+ * brought into model space by the instance (see ModelInstance::raycast).
+ * Holds a copy of the triangles in leaf order, so a query never touches the mesh.
+ * Queries are const and may run from any number of threads.
+ */
+class TriangleBVH {
+public:
+    struct Hit {
+        float t = std::numeric_limits<float>::max();   // distance along the ray direction.
+        int face = -1;                                  // index into the mesh's faces.
+        float u = 0.0f;                                 // barycentric weights of the
+        float v = 0.0f;                                 // face's second and third vertex.
+    };
+
+    /**
+     * @brief Builds the tree over the mesh's faces, replacing the previous one.
+     */
+    void build(const ModelLoader& mesh);
+
+    /**
+     * @brief Finds the nearest face hit by the ray, both sides of a face count.
+     *
+     * @param origin                             Ray origin, model space.
+     * @param dir         Ray direction, model space, need not be normalized.
+     * @param hit        Only faces closer than hit.t are considered, updated on a hit.
+     * @return                                   true if hit was updated.
+     */
+    bool raycast(const Vec3f& origin, const Vec3f& dir, Hit& hit) const;
+
+    [[nodiscard]] size_t size() const { return triangles.size(); }
+    [[nodiscard]] size_t nodeCount() const { return nodes.size(); }
+
+private:
+    // Leaves have count > 0 and hold triangles[first, first + count),
+    // inner nodes have count == 0 and their children at first and first + 1.
+    struct Node {
+        Vec3f min;
+        Vec3f max;
+        int first = 0;
+        int count = 0;
+    };
+
+    // Precomputed for the ray test - a vertex and the two edges from it.
+    struct Triangle {
+        Vec3f v0;
+        Vec3f e1;
+        Vec3f e2;
+        int face = 0;
+    };
+
+    void buildNode(int index, int begin, int end, std::vector<int>& order,
+                   std::span<const Face> faces, const std::vector<Vec3f>& centroids);
+
+    std::vector<Node> nodes;
+    std::vector<Triangle> triangles;
+
+    static constexpr int LEAF_SIZE = 4;
+    static constexpr int STACK_SIZE = 64;       // median splits keep the depth near log2(faces).
+};
+
+#endif //RENDERER_TRIANGLEBVH_H
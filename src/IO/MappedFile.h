@@ -0,0 +1,36 @@
+#ifndef RENDERER_MAPPEDFILE_H
+#define RENDERER_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Read-only memory mapping of a whole file. The pages are loaded on first
+ * access by the OS, and stay shared with the page cache, so mapping a file
+ * that was read recently costs no copy at all.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    // Maps the file, isOpen() is false if it cannot be opened or is empty.
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    [[nodiscard]] bool isOpen() const { return bytes != nullptr; }
+    [[nodiscard]] const char* data() const { return bytes; }
+    [[nodiscard]] size_t size() const { return length; }
+
+private:
+    void close();
+
+    const char* bytes = nullptr;
+    size_t length = 0;
+};
+
+#endif //RENDERER_MAPPEDFILE_H
@@ -0,0 +1,359 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "../Utils/TaskGroup.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+
+namespace {
+    // Bump whenever the stored arrays, or the way they are built (meshlets, LODs), change.
+    constexpr std::uint32_t MESH_CACHE_VERSION = 4;
+    constexpr char MESH_CACHE_MAGIC[8] = { 'R', 'M', 'E', 'S', 'H', 'C', 'A', 'C' };
+
+    // Arrays start on a cache line, which also covers the alignment of every element type.
+    constexpr std::uint64_t SECTION_ALIGNMENT = 64;
+
+    enum Array { VERTICES, NORMALS, TEXTURES, FACES, MESHLETS, ARRAY_COUNT };
+
+    // A face as stored - its corners' indices only. The positions, normals and uvs,
+    // and the face's tangent basis, are filled in on load.
+    struct FaceIndices {
+        std::int32_t vertex[3];
+        std::int32_t normal[3];
+        std::int32_t texture[3];
+    };
+
+    constexpr std::uint32_t ELEMENT_SIZES[ARRAY_COUNT] = {
+        sizeof(Point3), sizeof(Vec3f), sizeof(Vec2f), sizeof(FaceIndices), sizeof(Meshlet)
+    };
+
+    static_assert(std::is_trivially_copyable_v<Meshlet> && std::is_trivially_copyable_v<Vec3f> &&
+                  std::is_trivially_copyable_v<Vec2f>, "cached arrays are stored as raw bytes");
+
+    // Faces rebuilt per task on load.
+    constexpr int FILL_GRAIN = 16384;
+
+    // Where one array of one level lives in the file.
+    struct Section {
+        std::uint64_t offset = 0;
+        std::uint64_t count = 0;
+    };
+
+    // Followed by levelCount x ARRAY_COUNT sections, then the arrays themselves.
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t levelCount;
+        std::uint32_t elementSizes[ARRAY_COUNT];    // catches a layout change of an element type.
+        std::uint64_t sourceSize;
+        std::int64_t sourceTime;
+        std::uint64_t sourceHash;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    // One level as read from a cache - the faces and tangents filled in from the indices, the rest borrowed from the mapping.
+    struct LevelStorage {
+        std::shared_ptr<const MappedFile> file;
+        std::vector<Face> faces;
+        std::vector<TangentBasis> tangents;
+    };
+
+    struct Bytes {
+        const void* data;
+        std::uint64_t count;
+    };
+
+    std::vector<FaceIndices> faceIndicesOf(const ModelLoader& mesh)
+    {
+        std::vector<FaceIndices> indices(mesh.getFaces().size());
+        for (size_t f = 0; f < indices.size(); ++f) {
+            const Face& face = mesh.getFaces()[f];
+            for (int j = 0; j < 3; ++j) {
+                indices[f].vertex[j] = face.vertexIndices[j];
+                indices[f].normal[j] = face.normalIndices[j];
+                indices[f].texture[j] = face.textureIndices[j];
+            }
+        }
+        return indices;
+    }
+
+    // The rasterizer reads the faces and vertices of a meshlet unchecked.
+    bool meshletsFit(const std::span<const Meshlet> meshlets, const size_t faceCount, const size_t vertexCount)
+    {
+        return std::ranges::all_of(meshlets, [&](const Meshlet& meshlet) {
+            if (meshlet.firstFace < 0 || meshlet.faceCount < 0 ||
+                static_cast<size_t>(meshlet.firstFace) + meshlet.faceCount > faceCount ||
+                meshlet.vertexRangeCount < 0 || meshlet.vertexRangeCount > MESHLET_VERTEX_RANGES) {
+                return false;
+            }
+            return std::all_of(meshlet.vertexRanges, meshlet.vertexRanges + meshlet.vertexRangeCount,
+                               [&](const VertexRange& range) {
+                return range.begin >= 0 && range.end >= range.begin && static_cast<size_t>(range.end) <= vertexCount;
+            });
+        });
+    }
+
+    // Rebuilds the faces and their tangents, false if an index is outside the array it refers to.
+    bool fillFaces(const std::span<const FaceIndices> indices, const ModelLoader::Arrays& arrays,
+                   LevelStorage& out, ThreadPool& pool)
+    {
+        const auto inRange = [](const std::int32_t index, const size_t size, const bool optional) {
+            return (optional && index == -1) || (index >= 0 && static_cast<size_t>(index) < size);
+        };
+
+        out.faces.resize(indices.size());
+        out.tangents.resize(indices.size());
+        std::atomic<bool> valid = true;
+        parallelFor(0, static_cast<int>(indices.size()), FILL_GRAIN, [&](const int begin, const int end) {
+            for (int f = begin; f < end; ++f) {
+                const FaceIndices& stored = indices[f];
+                for (int j = 0; j < 3; ++j) {
+                    if (!inRange(stored.vertex[j], arrays.vertices.size(), false) ||
+                        !inRange(stored.normal[j], arrays.normals.size(), true) ||
+                        !inRange(stored.texture[j], arrays.textures.size(), true)) {
+                        valid.store(false, std::memory_order_relaxed);
+                        return;
+                    }
+                }
+                Face& face = out.faces[f];
+                face = Face(stored.vertex, stored.normal, stored.texture);
+                face.updateFace(arrays.vertices, arrays.normals, arrays.textures);
+                out.tangents[f] = calculateTriangleBasis(face.pts, face.uv);
+            }
+        }, pool);
+        return valid.load(std::memory_order_relaxed);
+    }
+
+    std::array<Bytes, ARRAY_COUNT> arraysOf(const ModelLoader& mesh, const std::vector<FaceIndices>& faces)
+    {
+        return {{
+            { mesh.getVertices().data(), mesh.getVertices().size() },
+            { mesh.getVerticesNormals().data(), mesh.getVerticesNormals().size() },
+            { mesh.getVerticesTexture().data(), mesh.getVerticesTexture().size() },
+            { faces.data(), faces.size() },
+            { mesh.getMeshlets().data(), mesh.getMeshlets().size() },
+        }};
+    }
+
+    template <typename T>
+    std::span<const T> arrayAt(const MappedFile& file, const Section& section)
+    {
+        return { reinterpret_cast<const T*>(file.data() + section.offset), static_cast<size_t>(section.count) };
+    }
+
+    bool fits(const Section& section, const std::uint64_t elementSize, const std::uint64_t fileSize)
+    {
+        return section.offset % SECTION_ALIGNMENT == 0 && section.offset <= fileSize &&
+               section.count <= (fileSize - section.offset) / elementSize;
+    }
+
+    std::uint64_t alignUp(const std::uint64_t offset)
+    {
+        return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+    // 64 bit hash of the content, eight bytes per step.
+    std::uint64_t hashBytes(const char* data, const size_t size)
+    {
+        constexpr std::uint64_t PRIME = 0x100000001b3ull;
+        std::uint64_t hash = 0xcbf29ce484222325ull ^ size;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * PRIME;
+            hash ^= hash >> 32;
+        }
+        for (; i < size; ++i) hash = (hash ^ static_cast<unsigned char>(data[i])) * PRIME;
+        return hash;
+    }
+
+    bool sourceStamp(const std::string& path, std::uint64_t& size, std::int64_t& time)
+    {
+        std::error_code error;
+        size = fs::file_size(path, error);
+        if (error) return false;
+        time = fs::last_write_time(path, error).time_since_epoch().count();
+        return !error;
+    }
+
+    bool hashFile(const std::string& path, const std::uint64_t size, std::uint64_t& hash)
+    {
+        if (size == 0) {
+            hash = hashBytes(nullptr, 0);
+            return true;
+        }
+        const MappedFile file(path);
+        if (!file.isOpen()) return false;
+        hash = hashBytes(file.data(), file.size());
+        return true;
+    }
+}
+
+std::string meshCachePath(const std::string& sourcePath)
+{
+    return sourcePath + ".meshcache";
+}
+
+bool readMeshCache(const std::string& sourcePath, MeshCacheData& out, ThreadPool& pool)
+{
+    std::uint64_t sourceSize;
+    std::int64_t sourceTime;
+    if (!sourceStamp(sourcePath, sourceSize, sourceTime)) return false;
+
+    const std::string cachePath = meshCachePath(sourcePath);
+    const auto file = std::make_shared<const MappedFile>(cachePath);
+    if (!file->isOpen() || file->size() < sizeof(Header)) return false;
+
+    Header header;
+    std::memcpy(&header, file->data(), sizeof(Header));
+    if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MESH_CACHE_VERSION ||
+        std::memcmp(header.elementSizes, ELEMENT_SIZES, sizeof(ELEMENT_SIZES)) != 0 ||
+        header.levelCount == 0 || header.levelCount > file->size() / (sizeof(Section) * ARRAY_COUNT) ||
+        header.sourceSize != sourceSize) {
+        return false;
+    }
+
+    std::vector<Section> table(static_cast<size_t>(header.levelCount) * ARRAY_COUNT);
+    const size_t tableBytes = table.size() * sizeof(Section);
+    if (file->size() < sizeof(Header) + tableBytes) return false;
+    std::memcpy(table.data(), file->data() + sizeof(Header), tableBytes);
+
+    for (size_t i = 0; i < table.size(); ++i) {
+        if (!fits(table[i], ELEMENT_SIZES[i % ARRAY_COUNT], file->size())) return false;
+    }
+
+    // Only a changed timestamp - the content decides, and the next start takes the fast path again.
+    if (header.sourceTime != sourceTime) {
+        std::uint64_t hash;
+        if (!hashFile(sourcePath, sourceSize, hash) || hash != header.sourceHash) return false;
+
+        std::fstream stream(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+        stream.seekp(offsetof(Header, sourceTime));
+        stream.write(reinterpret_cast<const char*>(&sourceTime), sizeof(sourceTime));
+    }
+
+    MeshCacheData data;
+    data.levels.reserve(header.levelCount);
+    for (std::uint32_t level = 0; level < header.levelCount; ++level) {
+        const Section* sections = &table[level * ARRAY_COUNT];
+
+        ModelLoader::Arrays arrays;
+        arrays.vertices = arrayAt<Point3>(*file, sections[VERTICES]);
+        arrays.normals = arrayAt<Vec3f>(*file, sections[NORMALS]);
+        arrays.textures = arrayAt<Vec2f>(*file, sections[TEXTURES]);
+        arrays.meshlets = arrayAt<Meshlet>(*file, sections[MESHLETS]);
+
+        auto storage = std::make_shared<LevelStorage>();
+        storage->file = file;
+        const auto indices = arrayAt<FaceIndices>(*file, sections[FACES]);
+        if (!meshletsFit(arrays.meshlets, indices.size(), arrays.vertices.size())) return false;
+        if (!fillFaces(indices, arrays, *storage, pool)) return false;
+        arrays.faces = storage->faces;
+        arrays.tangents = storage->tangents;
+        data.levels.emplace_back(std::move(storage), arrays);
+    }
+    data.boundsMin = Vec3f(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    data.boundsMax = Vec3f(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+    out = std::move(data);
+    return true;
+}
+
+bool sourceContentHash(const std::string& sourcePath, std::uint64_t& hash)
+{
+    std::uint64_t sourceSize;
+    std::int64_t sourceTime;
+    if (!sourceStamp(sourcePath, sourceSize, sourceTime)) return false;
+
+    // Only the header is read, the arrays need not be valid for the hash to be.
+    Header header;
+    std::ifstream stream(meshCachePath(sourcePath), std::ios::binary);
+    if (stream.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+        std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == MESH_CACHE_VERSION && header.sourceSize == sourceSize && header.sourceTime == sourceTime) {
+        hash = header.sourceHash;
+        return true;
+    }
+    return hashFile(sourcePath, sourceSize, hash);
+}
+
+bool writeMeshCache(const std::string& sourcePath, const MeshCacheData& data)
+{
+    if (data.levels.empty()) return false;
+
+    Header header {};
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.levelCount = static_cast<std::uint32_t>(data.levels.size());
+    std::memcpy(header.elementSizes, ELEMENT_SIZES, sizeof(ELEMENT_SIZES));
+    if (!sourceStamp(sourcePath, header.sourceSize, header.sourceTime)) return false;
+    if (!hashFile(sourcePath, header.sourceSize, header.sourceHash)) return false;
+    for (int i = 0; i < 3; ++i) {
+        header.boundsMin[i] = data.boundsMin[i];
+        header.boundsMax[i] = data.boundsMax[i];
+    }
+
+    // Arrays go after the header and the section table, level by level.
+    std::vector<std::vector<FaceIndices>> faces;
+    std::vector<std::array<Bytes, ARRAY_COUNT>> arrays;
+    std::vector<Section> table;
+    std::uint64_t offset = alignUp(sizeof(Header) + data.levels.size() * ARRAY_COUNT * sizeof(Section));
+    for (const auto& level : data.levels) {
+        faces.push_back(faceIndicesOf(level));
+        arrays.push_back(arraysOf(level, faces.back()));
+        for (int a = 0; a < ARRAY_COUNT; ++a) {
+            table.push_back({ offset, arrays.back()[a].count });
+            offset = alignUp(offset + arrays.back()[a].count * ELEMENT_SIZES[a]);
+        }
+    }
+
+    // Per process and thread, so meshes of the same source loaded side by side do not write into one file.
+    const std::string cachePath = meshCachePath(sourcePath);
+    const std::string tempPath = cachePath + "." + std::to_string(getpid()) + "." +
+                                 std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        if (!stream) return false;
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(Section)));
+        std::uint64_t written = sizeof(header) + table.size() * sizeof(Section);
+
+        const char padding[SECTION_ALIGNMENT] = {};
+        for (size_t i = 0; i < table.size(); ++i) {
+            const Bytes& bytes = arrays[i / ARRAY_COUNT][i % ARRAY_COUNT];
+            const std::uint64_t size = bytes.count * ELEMENT_SIZES[i % ARRAY_COUNT];
+            stream.write(padding, static_cast<std::streamsize>(table[i].offset - written));
+            if (size > 0) stream.write(static_cast<const char*>(bytes.data), static_cast<std::streamsize>(size));
+            written = table[i].offset + size;
+        }
+
+        if (!stream) {
+            stream.close();
+            std::error_code ignored;
+            fs::remove(tempPath, ignored);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tempPath, cachePath, error);
+    if (!error) return true;
+
+    fs::remove(tempPath, error);
+    return false;
+}
@@ -0,0 +1,64 @@
+#ifndef RENDERER_MESHCACHE_H
+#define RENDERER_MESHCACHE_H
+
+#include "ModelLoader.h"
+#include "../Utils/ThreadPool.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * A processed mesh as kept in a mesh cache - every level of detail with its
+ * vertices, filled in faces, meshlets and tangents, and the model space bounds.
+ *
+ * The cache is a binary file next to the source asset (<source>.meshcache).
+ * Faces are stored as their corners' index triplets next to the shared vertex,
+ * normal and uv arrays. The cache is read through a memory mapping: the faces
+ * and their tangents are filled in from the indices, every other array of a
+ * level points straight into the mapping, so a hit costs no parsing and no simplification.
+ */
+struct MeshCacheData {
+    std::vector<ModelLoader> levels;    // the full model first, then each coarser level.
+    Vec3f boundsMin;
+    Vec3f boundsMax;
+};
+
+// Where the cache of the source asset lives.
+std::string meshCachePath(const std::string& sourcePath);
+
+/**
+ * @brief Loads the cache of a source asset. A cache only counts if it was
+ *        written from the same source - same size, and the same modification
+ *        time or, when only the time changed (a checkout or a copy), the same
+ *        content hash, in which case the stored time is refreshed.
+ *
+ * @param sourcePath                                The asset the cache was made from.
+ * @param out                 Replaced with the cached mesh, untouched on a miss.
+ * @param pool                               Fills in the faces, with the calling thread.
+ * @return                   false if there is no valid cache for the source.
+ */
+bool readMeshCache(const std::string& sourcePath, MeshCacheData& out, ThreadPool& pool = ThreadPool::instance());
+
+/**
+ * @brief Content hash of a source asset, the one its mesh cache is checked
+ *        against. Taken from the cache when that was written from the file as
+ *        it is now (same size and time), computed from the content otherwise.
+ *        Works for any file, cached or not.
+ *
+ * @param sourcePath                                          The asset to hash.
+ * @param hash                                        Set to the hash on success.
+ * @return                                   false if the file cannot be read.
+ */
+bool sourceContentHash(const std::string& sourcePath, std::uint64_t& hash);
+
+/**
+ * @brief Writes the cache of a source asset, replacing the old one at once
+ *        (written to a temporary file first), so readers never see half a file.
+ *
+ * @param sourcePath                                The asset the mesh was made from.
+ * @param data                                                     The processed mesh.
+ * @return                false if the source or the cache could not be accessed.
+ */
+bool writeMeshCache(const std::string& sourcePath, const MeshCacheData& data);
+
+#endif //RENDERER_MESHCACHE_H
@@ -0,0 +1,274 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+    // Symmetric 4x4 matrix of the squared distance to a set of planes, upper triangle row by row.
+    struct Quadric {
+        double q[10] = {};
+
+        static Quadric plane(const Vec3f& n, const float d, const double weight)
+        {
+            const double a = n.x(), b = n.y(), c = n.z(), e = d;
+            Quadric quadric;
+            const double values[10] = { a * a, a * b, a * c, a * e, b * b, b * c, b * e, c * c, c * e, e * e };
+            for (int i = 0; i < 10; ++i) quadric.q[i] = values[i] * weight;
+            return quadric;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            for (int i = 0; i < 10; ++i) q[i] += other.q[i];
+            return *this;
+        }
+
+        [[nodiscard]] double error(const Vec3f& p) const
+        {
+            const double x = p.x(), y = p.y(), z = p.z();
+            return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+                 + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+                 + q[7] * z * z + 2 * q[8] * z
+                 + q[9];
+        }
+    };
+
+    // Collapse of 'from' into 'to', stale once either vertex changed since it was queued.
+    struct Collapse {
+        double cost;
+        int from, to;
+        std::uint32_t fromStamp, toStamp;
+
+        bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    // How strongly open borders resist moving, relative to the surface planes.
+    constexpr double BORDER_WEIGHT = 100.0;
+
+    std::uint64_t edgeKey(const int a, const int b)
+    {
+        return static_cast<std::uint64_t>(std::min(a, b)) << 32 | static_cast<std::uint32_t>(std::max(a, b));
+    }
+
+    class Simplifier {
+    public:
+        explicit Simplifier(const ModelLoader& model)
+            : positions(model.getVertices()),
+              faces(model.getFaces().begin(), model.getFaces().end()),
+              faceAlive(faces.size(), 1),
+              vertexFaces(positions.size()),
+              quadrics(positions.size()),
+              stamps(positions.size(), 0),
+              aliveFaces(static_cast<int>(faces.size()))
+        {
+            std::unordered_map<std::uint64_t, int> edgeFaces;
+            for (int f = 0; f < static_cast<int>(faces.size()); ++f) {
+                const int* idx = faces[f].vertexIndices;
+                for (int i = 0; i < 3; ++i) {
+                    vertexFaces[idx[i]].push_back(f);
+                    edgeFaces[edgeKey(idx[i], idx[(i + 1) % 3])]++;
+                }
+
+                const Vec3f n = normal(f);
+                const float area = n.length();
+                if (area == 0.0f) continue;
+                const Vec3f unit = n / area;
+                const Quadric quadric = Quadric::plane(unit, -dotProduct(unit, positions[idx[0]]), area * 0.5);
+                for (int i = 0; i < 3; ++i) quadrics[idx[i]] += quadric;
+            }
+
+            // A border edge gets a plane through it, perpendicular to its face.
+            for (int f = 0; f < static_cast<int>(faces.size()); ++f) {
+                const int* idx = faces[f].vertexIndices;
+                const Vec3f n = normal(f);
+                if (n.lengthSquared() == 0.0f) continue;
+
+                for (int i = 0; i < 3; ++i) {
+                    const int a = idx[i], b = idx[(i + 1) % 3];
+                    if (edgeFaces[edgeKey(a, b)] != 1) continue;
+
+                    const Vec3f edge = positions[b] - positions[a];
+                    const Vec3f perpendicular = cross(edge, n);
+                    if (perpendicular.lengthSquared() == 0.0f) continue;
+                    const Vec3f unit = perpendicular.normalize();
+                    const Quadric quadric = Quadric::plane(unit, -dotProduct(unit, positions[a]),
+                                                           BORDER_WEIGHT * edge.lengthSquared());
+                    quadrics[a] += quadric;
+                    quadrics[b] += quadric;
+                }
+            }
+
+            for (const auto& [key, count] : edgeFaces) {
+                queueEdge(static_cast<int>(key >> 32), static_cast<int>(key & 0xFFFFFFFFu));
+            }
+        }
+
+        void run(const int targetFaces)
+        {
+            while (aliveFaces > targetFaces && !heap.empty()) {
+                const Collapse collapse = heap.top();
+                heap.pop();
+
+                if (stamps[collapse.from] != collapse.fromStamp || stamps[collapse.to] != collapse.toStamp) continue;
+                if (!isValid(collapse.from, collapse.to)) continue;
+
+                apply(collapse.from, collapse.to);
+            }
+        }
+
+        std::vector<Face> result() const
+        {
+            std::vector<Face> out;
+            out.reserve(aliveFaces);
+            for (int f = 0; f < static_cast<int>(faces.size()); ++f) {
+                if (faceAlive[f]) out.push_back(faces[f]);
+            }
+            return out;
+        }
+
+    private:
+        [[nodiscard]] Vec3f normal(const int f) const
+        {
+            const int* idx = faces[f].vertexIndices;
+            return cross(positions[idx[1]] - positions[idx[0]], positions[idx[2]] - positions[idx[0]]);
+        }
+
+        [[nodiscard]] bool hasVertex(const int f, const int v) const
+        {
+            const int* idx = faces[f].vertexIndices;
+            return idx[0] == v || idx[1] == v || idx[2] == v;
+        }
+
+        void neighbours(const int v, std::vector<int>& out) const
+        {
+            out.clear();
+            for (const int f : vertexFaces[v]) {
+                if (!faceAlive[f]) continue;
+                for (const int w : faces[f].vertexIndices) {
+                    if (w != v) out.push_back(w);
+                }
+            }
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        }
+
+        void queueEdge(const int a, const int b)
+        {
+            Quadric sum = quadrics[a];
+            sum += quadrics[b];
+            const double intoA = sum.error(positions[a]);
+            const double intoB = sum.error(positions[b]);
+
+            if (intoA <= intoB) heap.push({ intoA, b, a, stamps[b], stamps[a] });
+            else heap.push({ intoB, a, b, stamps[a], stamps[b] });
+        }
+
+        [[nodiscard]] bool isValid(const int from, const int to)
+        {
+            // Link condition - the endpoints may only share the vertices opposite their shared faces.
+            int sharedFaces = 0;
+            for (const int f : vertexFaces[from]) {
+                if (faceAlive[f] && hasVertex(f, to)) sharedFaces++;
+            }
+            if (sharedFaces == 0) return false;
+
+            neighbours(from, fromNeighbours);
+            neighbours(to, toNeighbours);
+            int common = 0;
+            for (const int w : fromNeighbours) {
+                if (std::binary_search(toNeighbours.begin(), toNeighbours.end(), w)) common++;
+            }
+            if (common > sharedFaces) return false;
+
+            // No remaining face may flip or degenerate.
+            for (const int f : vertexFaces[from]) {
+                if (!faceAlive[f] || hasVertex(f, to)) continue;
+
+                const Vec3f before = normal(f);
+                int* idx = faces[f].vertexIndices;
+                const int corner = idx[0] == from ? 0 : idx[1] == from ? 1 : 2;
+                idx[corner] = to;
+                const Vec3f after = normal(f);
+                idx[corner] = from;
+
+                if (dotProduct(before, after) <= 0.0f) return false;
+            }
+            return true;
+        }
+
+        void apply(const int from, const int to)
+        {
+            for (const int f : vertexFaces[from]) {
+                if (!faceAlive[f]) continue;
+
+                if (hasVertex(f, to)) {
+                    faceAlive[f] = 0;
+                    aliveFaces--;
+                    continue;
+                }
+
+                int* idx = faces[f].vertexIndices;
+                const int corner = idx[0] == from ? 0 : idx[1] == from ? 1 : 2;
+                idx[corner] = to;
+                vertexFaces[to].push_back(f);
+            }
+            vertexFaces[from].clear();
+
+            auto& toFaces = vertexFaces[to];
+            toFaces.erase(std::remove_if(toFaces.begin(), toFaces.end(),
+                                         [this](const int f) { return !faceAlive[f]; }), toFaces.end());
+
+            quadrics[to] += quadrics[from];
+            stamps[from]++;
+            stamps[to]++;
+
+            // Only edges at 'to' changed cost, the others are re-validated when popped.
+            neighbours(to, toNeighbours);
+            for (const int w : toNeighbours) queueEdge(to, w);
+        }
+
+        std::span<const Point3> positions;
+        std::vector<Face> faces;
+        std::vector<char> faceAlive;
+        std::vector<std::vector<int>> vertexFaces;
+        std::vector<Quadric> quadrics;
+        std::vector<std::uint32_t> stamps;
+        int aliveFaces;
+
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> heap;
+        std::vector<int> fromNeighbours, toNeighbours;
+    };
+
+    // The elements the faces still refer to through indices, in order of first use, with the faces pointed at them.
+    template <typename T>
+    std::vector<T> compactReferenced(const std::span<const T> source, std::vector<Face>& faces, int (Face::*indices)[3])
+    {
+        std::vector<int> remap(source.size(), -1);
+        std::vector<T> kept;
+        for (auto& face : faces) {
+            for (int& index : face.*indices) {
+                if (index < 0) continue;
+                if (remap[index] < 0) {
+                    remap[index] = static_cast<int>(kept.size());
+                    kept.push_back(source[index]);
+                }
+                index = remap[index];
+            }
+        }
+        return kept;
+    }
+}
+
+ModelLoader simplifyMesh(const ModelLoader& model, const int targetFaces)
+{
+    Simplifier simplifier(model);
+    simplifier.run(targetFaces);
+
+    std::vector<Face> faces = simplifier.result();
+    auto vertices = compactReferenced(model.getVertices(), faces, &Face::vertexIndices);
+    auto normals = compactReferenced(model.getVerticesNormals(), faces, &Face::normalIndices);
+    auto textures = compactReferenced(model.getVerticesTexture(), faces, &Face::textureIndices);
+    return { std::move(vertices), std::move(normals), std::move(textures), std::move(faces) };
+}
@@ -0,0 +1,21 @@
+#ifndef RENDERER_MESHSIMPLIFIER_H
+#define RENDERER_MESHSIMPLIFIER_H
+
+#include "ModelLoader.h"
+
+/**
+ * @brief Simplifies a mesh with quadric error metrics (Garland & Heckbert).
+ *        Edges are collapsed cheapest first into one of their endpoints, so
+ *        no new positions are made and every face keeps its own normal and uv indices.
+ *        Open borders are held in place by extra quadrics, collapses that
+ *        would flip a face or make the mesh non-manifold are skipped.
+ *
+ * @param model                                    The mesh to simplify.
+ * @param targetFaces    Stops once at most this many faces are left, it
+ *                       may stop earlier if no valid collapse remains.
+ * @return     The simplified mesh, holding only the vertices, normals and
+ *             uvs its faces still use.
+ */
+ModelLoader simplifyMesh(const ModelLoader& model, int targetFaces);
+
+#endif //RENDERER_MESHSIMPLIFIER_H
@@ -1,71 +1,255 @@
 #include "ModelLoader.h"
+#include "ObjParser.h"
 
-void ModelLoader::loadFile(const std::string &fileName)
-{
-    std::ifstream inputFile(fileName);
+#include <algorithm>
+#include <cstdint>
 
-    if(!inputFile.is_open()) {
+ModelLoader::ModelLoader(const std::string& fileName, ThreadPool& pool)
+{
+    ObjMesh mesh;
+    if (!parseObjFile(fileName, mesh, pool)) {
         std::cerr << "Failed to open the file." << std::endl;
-        return;
     }
 
-    std::string line;
-    while(std::getline(inputFile, line)) {
-        std::istringstream iss(line);
-        std::string word;
+    build(std::move(mesh.vertices), std::move(mesh.normals), std::move(mesh.textures), std::move(mesh.faces));
+}
+
+ModelLoader::ModelLoader(std::vector<Point3> vertices, std::vector<Vec3f> normals,
+                         std::vector<Vec2f> textures, std::vector<Face> faces)
+{
+    build(std::move(vertices), std::move(normals), std::move(textures), std::move(faces));
+}
+
+ModelLoader::ModelLoader(std::shared_ptr<const void> storage, const Arrays& arrays)
+    : storage(std::move(storage)),
+      faces(arrays.faces),
+      meshlets(arrays.meshlets),
+      tangents(arrays.tangents),
+      vertices(arrays.vertices),
+      normals(arrays.normals),
+      textures(arrays.textures)
+{
+    buildVertexStreams();
+}
+
+void ModelLoader::build(std::vector<Point3> vertexData, std::vector<Vec3f> normalData,
+                        std::vector<Vec2f> textureData, std::vector<Face> faceData)
+{
+    for (auto& face : faceData) {
+        face.updateFace(vertexData, normalData, textureData);
+    }
+    std::vector<Meshlet> meshletData = buildMeshlets(faceData);
+    vertexData = orderVerticesByFirstUse(std::move(vertexData), faceData, meshletData);
+    meshlets = std::move(meshletData);
+
+    std::vector<TangentBasis> basis(faceData.size());
+    for (size_t f = 0; f < faceData.size(); ++f) {
+        basis[f] = calculateTriangleBasis(faceData[f].pts, faceData[f].uv);
+    }
+
+    tangents = std::move(basis);
+    faces = std::move(faceData);
+    vertices = std::move(vertexData);
+    normals = std::move(normalData);
+    textures = std::move(textureData);
+    buildVertexStreams();
+}
+
+namespace {
+    // Spreads the low 10 bits of v so there are two zero bits between each.
+    std::uint32_t expandBits(std::uint32_t v)
+    {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    }
+
+    // Unnormalized, so degenerate faces are the ones with a zero normal.
+    Vec3f faceNormal(const Face& face)
+    {
+        return cross(face.pts[1] - face.pts[0], face.pts[2] - face.pts[0]);
+    }
+
+    // Index of the axis the normal mostly points to, 0-5 for +x, -x, +y, -y, +z, -z.
+    int normalBucket(const Vec3f& n)
+    {
+        int axis = 0;
+        for (int i = 1; i < 3; ++i) {
+            if (std::abs(n[i]) > std::abs(n[axis])) axis = i;
+        }
+        return axis * 2 + (n[axis] < 0.0f ? 1 : 0);
+    }
 
-        iss >> word;
+    // Runs of the used vertices, the closest runs joined until they fit the meshlet.
+    // Most vertices of a meshlet are numbered together, the runs catch the ones
+    // shared with meshlets far away in the order.
+    void setVertexRanges(Meshlet& meshlet, std::vector<int>& used)
+    {
+        std::sort(used.begin(), used.end());
+        used.erase(std::unique(used.begin(), used.end()), used.end());
 
-        if(word == "v") {
-            // Handle vertices
-            float x, y, z;
-            iss >> x;
-            iss >> y;
-            iss >> z;
+        std::vector<VertexRange> runs;
+        for (const int index : used) {
+            if (!runs.empty() && runs.back().end == index) {
+                runs.back().end++;
+            } else {
+                runs.push_back({ index, index + 1 });
+            }
+        }
 
-            Vec3f v{x, y, z} ;
-            vertices.push_back(v);
+        while (runs.size() > MESHLET_VERTEX_RANGES) {
+            size_t closest = 0;
+            for (size_t r = 1; r + 1 < runs.size(); ++r) {
+                if (runs[r + 1].begin - runs[r].end < runs[closest + 1].begin - runs[closest].end) closest = r;
+            }
+            runs[closest].end = runs[closest + 1].end;
+            runs.erase(runs.begin() + static_cast<std::ptrdiff_t>(closest) + 1);
         }
 
-        if (word == "f") {
-            // Handle faces
-            int v, vt, vn;
-            int verticesIndices[3], normalIndices[3], textureIndices[3];
-
-            for (int i = 0; i < 3; i++) {
-                iss >> word;
-                if (sscanf(word.c_str(), "%d/%d/%d", &v, &vt, &vn) >= 1) {
-                    // zero based.
-                    verticesIndices[i] = v - 1;
-                    normalIndices[i] = vn - 1;
-                    textureIndices[i] = vt - 1;
+        meshlet.vertexRangeCount = static_cast<int>(runs.size());
+        std::copy(runs.begin(), runs.end(), meshlet.vertexRanges);
+    }
+
+    Meshlet makeMeshlet(const std::vector<Face>& faces, const int first, const int count)
+    {
+        Meshlet meshlet;
+        meshlet.firstFace = first;
+        meshlet.faceCount = count;
+
+        Vec3f min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                  std::numeric_limits<float>::max());
+        Vec3f max = min * -1.0f;
+        Vec3f normalSum;
+        for (int f = first; f < first + count; ++f) {
+            for (const auto& p : faces[f].pts) {
+                for (int i = 0; i < 3; ++i) {
+                    min[i] = std::min(min[i], p[i]);
+                    max[i] = std::max(max[i], p[i]);
                 }
             }
+            const Vec3f n = faceNormal(faces[f]);
+            if (n.lengthSquared() > 0.0f) normalSum = normalSum + n.normalize();
+        }
 
-            Face f { verticesIndices, normalIndices, textureIndices };
-            faces.push_back(f);
+        meshlet.center = (min + max) * 0.5f;
+        for (int f = first; f < first + count; ++f) {
+            for (const auto& p : faces[f].pts) {
+                meshlet.radius = std::max(meshlet.radius, (p - meshlet.center).length());
+            }
         }
 
+        if (normalSum.lengthSquared() == 0.0f) return meshlet;
+
+        // The cone is as wide as the face normal furthest from the average.
+        meshlet.coneAxis = normalSum.normalize();
+        float minDot = 1.0f;
+        for (int f = first; f < first + count; ++f) {
+            const Vec3f n = faceNormal(faces[f]);
+            if (n.lengthSquared() > 0.0f) minDot = std::min(minDot, dotProduct(n.normalize(), meshlet.coneAxis));
+        }
+        meshlet.coneCutoff = minDot > 0.0f ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+        return meshlet;
+    }
+}
 
-        if (word == "vn") {
-            float x, y, z;
-            iss >> x;
-            iss >> y;
-            iss >> z;
+std::vector<Point3> ModelLoader::orderVerticesByFirstUse(std::vector<Point3> vertexData, std::vector<Face>& faces,
+                                                         std::vector<Meshlet>& meshlets)
+{
+    constexpr int UNUSED = -1;
+    std::vector<int> remap(vertexData.size(), UNUSED);
+    std::vector<Point3> ordered;
+    ordered.reserve(vertexData.size());
 
-            Vec3f vn{x, y, z};
-            normals.push_back(vn);
+    std::vector<int> used;
+    for (auto& meshlet : meshlets) {
+        used.clear();
+        for (int f = meshlet.firstFace; f < meshlet.firstFace + meshlet.faceCount; ++f) {
+            for (int& index : faces[f].vertexIndices) {
+                if (remap[index] == UNUSED) {
+                    remap[index] = static_cast<int>(ordered.size());
+                    ordered.push_back(vertexData[index]);
+                }
+                index = remap[index];
+                used.push_back(index);
+            }
         }
+        setVertexRanges(meshlet, used);
+    }
+
+    // Vertices no face uses go last, so the count stays the same.
+    for (size_t v = 0; v < vertexData.size(); ++v) {
+        if (remap[v] == UNUSED) ordered.push_back(vertexData[v]);
+    }
+    return ordered;
+}
 
-        if (word == "vt") {
-            float x, y;
-            iss >> x;
-            iss >> y;
+void ModelLoader::buildVertexStreams()
+{
+    const std::span<const Point3> positions = vertices.span();
+    const size_t count = positions.size();
+    vertexStreams.x.resize(count);
+    vertexStreams.y.resize(count);
+    vertexStreams.z.resize(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        vertexStreams.x[i] = positions[i].x();
+        vertexStreams.y[i] = positions[i].y();
+        vertexStreams.z[i] = positions[i].z();
+    }
+}
+
+std::vector<Meshlet> ModelLoader::buildMeshlets(std::vector<Face>& faces)
+{
+    std::vector<Meshlet> meshlets;
+    const int numFaces = static_cast<int>(faces.size());
+    if (numFaces == 0) return meshlets;
+
+    auto centroid = [](const Face& face) { return (face.pts[0] + face.pts[1] + face.pts[2]) / 3.0f; };
 
-            Vec2f vt{x, y};
-            textures.push_back(vt);
+    Vec3f min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+              std::numeric_limits<float>::max());
+    Vec3f max = min * -1.0f;
+    for (const auto& face : faces) {
+        const Vec3f c = centroid(face);
+        for (int i = 0; i < 3; ++i) {
+            min[i] = std::min(min[i], c[i]);
+            max[i] = std::max(max[i], c[i]);
         }
     }
 
-    inputFile.close();
+    // Sort key - normal bucket on top, 30 bit Morton code of the centroid below.
+    std::vector<std::pair<std::uint64_t, int>> keys(numFaces);
+    for (int f = 0; f < numFaces; ++f) {
+        const Vec3f c = centroid(faces[f]);
+        std::uint32_t code = 0;
+        for (int i = 0; i < 3; ++i) {
+            const float extent = max[i] - min[i];
+            const float t = extent > 0.0f ? (c[i] - min[i]) / extent : 0.0f;
+            code |= expandBits(static_cast<std::uint32_t>(t * 1023.0f)) << i;
+        }
+        const auto bucket = static_cast<std::uint64_t>(normalBucket(faceNormal(faces[f])));
+        keys[f] = { bucket << 30 | code, f };
+    }
+    std::stable_sort(keys.begin(), keys.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<Face> sorted;
+    sorted.reserve(numFaces);
+    for (const auto& key : keys) sorted.push_back(faces[key.second]);
+    faces = std::move(sorted);
+
+    // Cut into runs of MESHLET_SIZE, never across buckets so cones stay narrow.
+    int first = 0;
+    while (first < numFaces) {
+        const std::uint64_t bucket = keys[first].first >> 30;
+        int end = first + 1;
+        while (end < numFaces && end - first < MESHLET_SIZE && keys[end].first >> 30 == bucket) ++end;
+
+        meshlets.push_back(makeMeshlet(faces, first, end - first));
+        first = end;
+    }
+
+    return meshlets;
 }
@@ -1,38 +1,122 @@
 #ifndef RENDERER_MODELLOADER_H
 #define RENDERER_MODELLOADER_H
 
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <span>
 #include <sstream>
 #include <string>
 
 #include "../Math/Geometry.h"
+#include "../Utils/ThreadPool.h"
 
 namespace fs = std::filesystem;
 
+/**
+ * Elements of one mesh array, either owned or borrowed from memory that
+ * outlives the array (a mapped mesh cache, see MeshCache.h).
+ * A copy of a borrowed array borrows the same memory.
+ */
+template <typename T>
+class MeshArray {
+public:
+    MeshArray() = default;
+    MeshArray(std::vector<T> elements) : owned(std::move(elements)), view(owned) {}
+    explicit MeshArray(const std::span<const T> borrowed) : view(borrowed), borrowed(true) {}
+
+    MeshArray(const MeshArray& other)
+        : owned(other.owned), view(other.borrowed ? other.view : std::span<const T>(owned)),
+          borrowed(other.borrowed) {}
+
+    MeshArray(MeshArray&& other) noexcept
+        : owned(std::move(other.owned)), view(other.borrowed ? other.view : std::span<const T>(owned)),
+          borrowed(other.borrowed) {
+        other.view = {};
+    }
+
+    MeshArray& operator=(MeshArray other) noexcept {
+        owned = std::move(other.owned);
+        borrowed = other.borrowed;
+        view = borrowed ? other.view : std::span<const T>(owned);
+        return *this;
+    }
+
+    [[nodiscard]] std::span<const T> span() const { return view; }
+
+private:
+    std::vector<T> owned;
+    std::span<const T> view;
+    bool borrowed = false;
+};
+
 class ModelLoader {
 
 public:
-    explicit ModelLoader(const std::string& fileName) {
-        loadFile(fileName);
-        for (auto &face: faces) {
-            face.updateFace(vertices, normals, textures);
-        }
-    }
+    // Every array of a processed mesh, as stored in a mesh cache.
+    struct Arrays {
+        std::span<const Point3> vertices;
+        std::span<const Vec3f> normals;
+        std::span<const Vec2f> textures;
+        std::span<const Face> faces;
+        std::span<const Meshlet> meshlets;
+        std::span<const TangentBasis> tangents;
+    };
+
+    // Parses an OBJ file, on pool (see parseObjFile).
+    explicit ModelLoader(const std::string& fileName, ThreadPool& pool = ThreadPool::instance());
+
+    // Builds a mesh from already loaded data, the faces only need their indices set.
+    ModelLoader(std::vector<Point3> vertices, std::vector<Vec3f> normals,
+                std::vector<Vec2f> textures, std::vector<Face> faces);
 
-    [[nodiscard]] const std::vector<Face>& getFaces() const { return faces; }
-    std::vector<Face>& getFaces() { return faces; }
-    [[nodiscard]] const std::vector<Vec3f>& getVertices() const { return vertices; }
-    [[nodiscard]] const std::vector<Vec3f>& getVerticesNormals() const { return normals; }
-    [[nodiscard]] const std::vector<Vec2f>& getVerticesTexture() const { return textures; }
+    /**
+     * @brief Wraps arrays that were processed before (faces filled in and in
+     *        meshlet order, vertices in first use order, tangents computed),
+     *        nothing is copied but the vertex streams. storage keeps the
+     *        memory of the arrays alive.
+     */
+    ModelLoader(std::shared_ptr<const void> storage, const Arrays& arrays);
+
+    [[nodiscard]] std::span<const Face> getFaces() const { return faces.span(); }
+    [[nodiscard]] std::span<const Meshlet> getMeshlets() const { return meshlets.span(); }
+    [[nodiscard]] std::span<const TangentBasis> getTangents() const { return tangents.span(); }
+    [[nodiscard]] std::span<const Vec3f> getVertices() const { return vertices.span(); }
+    [[nodiscard]] const VertexStreams& getVertexStreams() const { return vertexStreams; }
+    [[nodiscard]] std::span<const Vec3f> getVerticesNormals() const { return normals.span(); }
+    [[nodiscard]] std::span<const Vec2f> getVerticesTexture() const { return textures.span(); }
 
 private:
-    void loadFile(const std::string &fileName);
+    void build(std::vector<Point3> vertexData, std::vector<Vec3f> normalData,
+               std::vector<Vec2f> textureData, std::vector<Face> faceData);
+
+    /**
+     * Reorders the faces into meshlets - faces are grouped by the axis their
+     * normal mostly points to, then sorted along a Morton curve and cut
+     * into runs of MESHLET_SIZE, so each meshlet is compact and has a narrow normal cone.
+     */
+    static std::vector<Meshlet> buildMeshlets(std::vector<Face>& faceData);
+
+    /**
+     * Renumbers the vertices in the order the meshlets first use them, so the
+     * vertices of a meshlet sit close together, and sets each meshlet's vertex
+     * ranges. Only the positions are reordered, normals and uvs have their own indices.
+     */
+    static std::vector<Point3> orderVerticesByFirstUse(std::vector<Point3> vertexData, std::vector<Face>& faces,
+                                                       std::vector<Meshlet>& meshlets);
+
+    // Copies the vertex positions into vertexStreams.
+    void buildVertexStreams();
 
-    std::vector<Face> faces;
-    std::vector<Point3> vertices;
-    std::vector<Vec3f> normals;
-    std::vector<Vec2f> textures;
+    std::shared_ptr<const void> storage;
+    MeshArray<Face> faces;
+    MeshArray<Meshlet> meshlets;
+    MeshArray<TangentBasis> tangents;
+    VertexStreams vertexStreams;
+    MeshArray<Point3> vertices;
+    MeshArray<Vec3f> normals;
+    MeshArray<Vec2f> textures;
 };
 
 #endif //RENDERER_MODELLOADER_H
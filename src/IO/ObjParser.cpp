@@ -0,0 +1,244 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "../Utils/TaskGroup.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    // Bytes of text per parallel chunk.
+    constexpr size_t CHUNK_BYTES = 1 << 20;
+
+    // A polygon corner as written - index[0..2] are v, vt, vn. Indices are
+    // 0-based, -1 when missing, and relative to the chunk's first element
+    // when their bit in 'relative' is set (negative indices in the file).
+    struct Corner {
+        int index[3] = { -1, -1, -1 };
+        std::uint8_t relative = 0;
+    };
+
+    struct Chunk {
+        std::vector<Point3> vertices;
+        std::vector<Vec2f> textures;
+        std::vector<Vec3f> normals;
+        std::vector<Corner> corners;        // three per triangle.
+        std::vector<Face> faces;            // corners resolved against the whole file.
+    };
+
+    bool isSpace(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    const char* skipSpaces(const char* p, const char* end)
+    {
+        while (p < end && isSpace(*p)) ++p;
+        return p;
+    }
+
+    // Null if there is no number at p.
+    const char* parseFloat(const char* p, const char* end, float& value)
+    {
+        if (p < end && *p == '+') ++p;
+#if defined(__cpp_lib_to_chars)
+        const auto result = std::from_chars(p, end, value);
+        if (result.ec == std::errc::result_out_of_range) value = 0.0f;
+        return result.ptr == p ? nullptr : result.ptr;
+#else
+        // No floating point from_chars in this standard library, strtof needs a terminated copy.
+        char buffer[64];
+        size_t length = 0;
+        while (p + length < end && length + 1 < sizeof(buffer) && !isSpace(p[length]) && p[length] != '\n') {
+            buffer[length] = p[length];
+            ++length;
+        }
+        buffer[length] = '\0';
+        char* stop;
+        value = std::strtof(buffer, &stop);
+        return stop == buffer ? nullptr : p + (stop - buffer);
+#endif
+    }
+
+    const char* parseInt(const char* p, const char* end, int& value)
+    {
+        if (p < end && *p == '+') ++p;
+        const auto result = std::from_chars(p, end, value);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+
+    // Reads up to 'count' numbers, the missing ones stay 0.
+    const char* parseFloats(const char* p, const char* end, float* values, const int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            p = skipSpaces(p, end);
+            const char* next = parseFloat(p, end, values[i]);
+            if (!next) break;
+            p = next;
+        }
+        return p;
+    }
+
+    void parseFace(const char* p, const char* end, const int counts[3], std::vector<Corner>& polygon,
+                   std::vector<Corner>& corners)
+    {
+        polygon.clear();
+        while (true) {
+            p = skipSpaces(p, end);
+            if (p >= end || *p == '\n' || *p == '#') break;
+
+            Corner corner;
+            for (int k = 0; k < 3; ++k) {
+                int value;
+                const char* next = parseInt(p, end, value);
+                if (next) {
+                    p = next;
+                    if (value < 0) {
+                        corner.index[k] = counts[k] + value;
+                        corner.relative |= 1u << k;
+                    } else {
+                        corner.index[k] = value - 1;
+                    }
+                }
+                if (k == 2 || p >= end || *p != '/') break;
+                ++p;
+            }
+            // Skip whatever is left of a malformed corner.
+            while (p < end && !isSpace(*p) && *p != '\n') ++p;
+            polygon.push_back(corner);
+        }
+
+        for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+            corners.push_back(polygon[0]);
+            corners.push_back(polygon[i]);
+            corners.push_back(polygon[i + 1]);
+        }
+    }
+
+    void parseChunk(const char* p, const char* end, Chunk& chunk)
+    {
+        const size_t estimate = static_cast<size_t>(end - p) / 32;
+        chunk.vertices.reserve(estimate);
+        chunk.corners.reserve(estimate);
+
+        std::vector<Corner> polygon;
+        while (p < end) {
+            p = skipSpaces(p, end);
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!lineEnd) lineEnd = end;
+
+            if (lineEnd - p >= 2 && isSpace(p[1]) && p[0] == 'v') {
+                float xyz[3] = {};
+                parseFloats(p + 2, lineEnd, xyz, 3);
+                chunk.vertices.emplace_back(xyz[0], xyz[1], xyz[2]);
+            } else if (lineEnd - p >= 3 && isSpace(p[2]) && p[0] == 'v' && p[1] == 't') {
+                float uv[2] = {};
+                parseFloats(p + 3, lineEnd, uv, 2);
+                chunk.textures.emplace_back(uv[0], uv[1]);
+            } else if (lineEnd - p >= 3 && isSpace(p[2]) && p[0] == 'v' && p[1] == 'n') {
+                float xyz[3] = {};
+                parseFloats(p + 3, lineEnd, xyz, 3);
+                chunk.normals.emplace_back(xyz[0], xyz[1], xyz[2]);
+            } else if (lineEnd - p >= 2 && isSpace(p[1]) && p[0] == 'f') {
+                const int counts[3] = { static_cast<int>(chunk.vertices.size()),
+                                        static_cast<int>(chunk.textures.size()),
+                                        static_cast<int>(chunk.normals.size()) };
+                parseFace(p + 2, lineEnd, counts, polygon, chunk.corners);
+            }
+
+            p = lineEnd + 1;
+        }
+    }
+
+    // Turns the chunk's corners into faces, given how many elements came before the chunk.
+    void resolveChunk(Chunk& chunk, const int bases[3], const int totals[3])
+    {
+        chunk.faces.reserve(chunk.corners.size() / 3);
+        for (size_t c = 0; c + 2 < chunk.corners.size(); c += 3) {
+            int indices[3][3];
+            bool valid = true;
+            for (int j = 0; j < 3; ++j) {
+                const Corner& corner = chunk.corners[c + j];
+                for (int k = 0; k < 3; ++k) {
+                    int index = corner.index[k];
+                    if (corner.relative & (1u << k)) index += bases[k];
+                    if (index < 0 || index >= totals[k]) index = -1;
+                    indices[k][j] = index;
+                }
+                valid = valid && indices[0][j] >= 0;
+            }
+            if (valid) chunk.faces.emplace_back(indices[0], indices[2], indices[1]);
+        }
+        chunk.corners.clear();
+        chunk.corners.shrink_to_fit();
+    }
+
+    template <typename T>
+    void gather(std::vector<Chunk>& chunks, std::vector<T> Chunk::* member, const std::vector<size_t>& offsets,
+                std::vector<T>& out, ThreadPool& pool)
+    {
+        out.resize(offsets.back());
+        parallelFor(0, static_cast<int>(chunks.size()), 1, [&](const int begin, const int end) {
+            for (int c = begin; c < end; ++c) {
+                const auto& part = chunks[c].*member;
+                std::copy(part.begin(), part.end(), out.begin() + static_cast<std::ptrdiff_t>(offsets[c]));
+            }
+        }, pool);
+    }
+
+    template <typename T>
+    std::vector<size_t> prefixSum(const std::vector<Chunk>& chunks, std::vector<T> Chunk::* member)
+    {
+        std::vector<size_t> offsets(chunks.size() + 1, 0);
+        for (size_t c = 0; c < chunks.size(); ++c) offsets[c + 1] = offsets[c] + (chunks[c].*member).size();
+        return offsets;
+    }
+}
+
+void parseObjText(const std::string_view text, ObjMesh& out, ThreadPool& pool)
+{
+    const char* data = text.data();
+    const size_t size = text.size();
+
+    // Chunk boundaries moved forward to the next line start.
+    std::vector<size_t> bounds = { 0 };
+    for (size_t target = CHUNK_BYTES; target < size; target += CHUNK_BYTES) {
+        if (target <= bounds.back()) continue;
+        const void* newline = std::memchr(data + target, '\n', size - target);
+        if (!newline) break;
+        bounds.push_back(static_cast<const char*>(newline) - data + 1);
+    }
+    bounds.push_back(size);
+
+    const int numChunks = static_cast<int>(bounds.size()) - 1;
+    std::vector<Chunk> chunks(numChunks);
+    parallelFor(0, numChunks, 1, [&](const int begin, const int end) {
+        for (int c = begin; c < end; ++c) parseChunk(data + bounds[c], data + bounds[c + 1], chunks[c]);
+    }, pool);
+
+    const auto vertexOffsets = prefixSum(chunks, &Chunk::vertices);
+    const auto textureOffsets = prefixSum(chunks, &Chunk::textures);
+    const auto normalOffsets = prefixSum(chunks, &Chunk::normals);
+    const int totals[3] = { static_cast<int>(vertexOffsets.back()), static_cast<int>(textureOffsets.back()),
+                            static_cast<int>(normalOffsets.back()) };
+
+    parallelFor(0, numChunks, 1, [&](const int begin, const int end) {
+        for (int c = begin; c < end; ++c) {
+            const int bases[3] = { static_cast<int>(vertexOffsets[c]), static_cast<int>(textureOffsets[c]),
+                                   static_cast<int>(normalOffsets[c]) };
+            resolveChunk(chunks[c], bases, totals);
+        }
+    }, pool);
+
+    gather(chunks, &Chunk::vertices, vertexOffsets, out.vertices, pool);
+    gather(chunks, &Chunk::textures, textureOffsets, out.textures, pool);
+    gather(chunks, &Chunk::normals, normalOffsets, out.normals, pool);
+    gather(chunks, &Chunk::faces, prefixSum(chunks, &Chunk::faces), out.faces, pool);
+}
+
+bool parseObjFile(const std::string& path, ObjMesh& out, ThreadPool& pool)
+{
+    const MappedFile file(path);
+    if (!file.isOpen()) return false;
+
+    parseObjText(std::string_view(file.data(), file.size()), out, pool);
+    return true;
+}
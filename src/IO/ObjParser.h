@@ -0,0 +1,37 @@
+#ifndef RENDERER_OBJPARSER_H
+#define RENDERER_OBJPARSER_H
+
+#include "../Math/Geometry.h"
+#include "../Utils/ThreadPool.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Contents of an OBJ file, faces triangulated and indexed from 0.
+struct ObjMesh {
+    std::vector<Point3> vertices;
+    std::vector<Vec3f> normals;
+    std::vector<Vec2f> textures;
+    std::vector<Face> faces;        // indices only, -1 for a missing uv or normal.
+};
+
+/**
+ * @brief Parses an OBJ file. The file is memory mapped and cut into line
+ *        aligned chunks that are parsed in parallel, then stitched in order.
+ *        Reads v, vt, vn and f - the v, v/vt, v//vn and v/vt/vn corner forms,
+ *        negative (relative) indices, and polygons, which are fan triangulated.
+ *        Faces with a vertex index out of range are dropped, other statements are ignored.
+ *
+ * @param path                                       The OBJ file.
+ * @param out                      Replaced with the file's contents.
+ * @param pool                        Runs the chunks, with the calling thread.
+ * @return                    false if the file could not be read.
+ */
+bool parseObjFile(const std::string& path, ObjMesh& out, ThreadPool& pool = ThreadPool::instance());
+
+/**
+ * @brief Same as parseObjFile, for OBJ text already in memory.
+ */
+void parseObjText(std::string_view text, ObjMesh& out, ThreadPool& pool = ThreadPool::instance());
+
+#endif //RENDERER_OBJPARSER_H
@@ -1,100 +1,99 @@
 #include <iostream>
 #include <cstring>
 #include "tgaimage.h"
+#include "MappedFile.h"
+#include <algorithm>
 
 TGAImage::TGAImage(const int w, const int h, const int bpp) : w(w), h(h), bpp(bpp), data(w*h*bpp, 0) {}
 
-bool TGAImage::read_tga_file(const std::string filename) {
-    std::ifstream in;
-    in.open(filename, std::ios::binary);
-    if (!in.is_open()) {
-        std::cerr << "can't open file " << filename << "\n";
+bool TGAImage::read_tga_file(const std::string filename, const bool vflip) {
+    // A failed read leaves an empty image, never a buffer with undecoded pixels in it.
+    const auto fail = [this](const char *message) {
+        std::cerr << message;
+        w = h = bpp = 0;
+        data = {};
         return false;
+    };
+    const MappedFile file(filename);
+    if (!file.isOpen()) {
+        std::cerr << "can't open file " << filename << "\n";
+        return fail("");
     }
+    const auto *in  = reinterpret_cast<const std::uint8_t *>(file.data());
+    const auto *end = in + file.size();
     TGAHeader header;
-    in.read(reinterpret_cast<char *>(&header), sizeof(header));
-    if (!in.good()) {
-        std::cerr << "an error occured while reading the header\n";
-        return false;
-    }
+    if (file.size() < sizeof(header))
+        return fail("an error occured while reading the header\n");
+    memcpy(&header, in, sizeof(header));
     w   = header.width;
     h   = header.height;
     bpp = header.bitsperpixel>>3;
-    if (w<=0 || h<=0 || (bpp!=GRAYSCALE && bpp!=RGB && bpp!=RGBA)) {
-        std::cerr << "bad bpp (or width/height) value\n";
-        return false;
-    }
-    size_t nbytes = bpp*w*h;
-    data = std::vector<std::uint8_t>(nbytes, 0);
+    if (w<=0 || h<=0 || (bpp!=GRAYSCALE && bpp!=RGB && bpp!=RGBA))
+        return fail("bad bpp (or width/height) value\n");
+    // Skip the image id and the color map, neither is used.
+    const size_t colormapbytes = header.colormaptype ? header.colormaplength*((header.colormapdepth+7)>>3) : 0;
+    in += std::min<size_t>(end-in, sizeof(header) + header.idlength + colormapbytes);
+
+    // Rows go straight to their final place: the file stores them bottom-up
+    // unless the top-left origin bit is set, the image keeps them top-down unless vflip.
+    const bool flip_rows = ((header.imagedescriptor & 0x20) == 0) != vflip;
+    const size_t rowbytes = static_cast<size_t>(w)*bpp;
+    data = AlignedVector<std::uint8_t>(rowbytes*h);
     if (3==header.datatypecode || 2==header.datatypecode) {
-        in.read(reinterpret_cast<char *>(data.data()), nbytes);
-        if (!in.good()) {
-            std::cerr << "an error occured while reading the data\n";
-            return false;
-        }
+        if (static_cast<size_t>(end-in) < rowbytes*h)
+            return fail("an error occured while reading the data\n");
+        for (int row=0; row<h; row++)
+            memcpy(data.data() + (flip_rows ? h-1-row : row)*rowbytes, in + row*rowbytes, rowbytes);
     } else if (10==header.datatypecode||11==header.datatypecode) {
-        if (!load_rle_data(in)) {
-            std::cerr << "an error occured while reading the data\n";
-            return false;
-        }
+        if (!load_rle_data(in, end, flip_rows))
+            return fail("an error occured while reading the data\n");
     } else {
         std::cerr << "unknown file format " << (int)header.datatypecode << "\n";
-        return false;
+        return fail("");
     }
-    if (!(header.imagedescriptor & 0x20))
-        flip_vertically();
     if (header.imagedescriptor & 0x10)
         flip_horizontally();
     std::cerr << w << "x" << h << "/" << bpp*8 << "\n";
     return true;
 }
 
-bool TGAImage::load_rle_data(std::ifstream &in) {
-    size_t pixelcount = w*h;
-    size_t currentpixel = 0;
-    size_t currentbyte  = 0;
-    TGAColor colorbuffer;
-    do {
-        std::uint8_t chunkheader = 0;
-        chunkheader = in.get();
-        if (!in.good()) {
-            std::cerr << "an error occured while reading the data\n";
-            return false;
-        }
-        if (chunkheader<128) {
-            chunkheader++;
-            for (int i=0; i<chunkheader; i++) {
-                in.read(reinterpret_cast<char *>(colorbuffer.bgra), bpp);
-                if (!in.good()) {
-                    std::cerr << "an error occured while reading the header\n";
-                    return false;
-                }
-                for (int t=0; t<bpp; t++)
-                    data[currentbyte++] = colorbuffer.bgra[t];
-                currentpixel++;
-                if (currentpixel>pixelcount) {
-                    std::cerr << "Too many pixels read\n";
-                    return false;
-                }
-            }
-        } else {
-            chunkheader -= 127;
-            in.read(reinterpret_cast<char *>(colorbuffer.bgra), bpp);
-            if (!in.good()) {
-                std::cerr << "an error occured while reading the header\n";
+// Decodes packet by packet: raw packets are copied in bulk and runs are filled by doubling
+// the copied span, both split only where a packet crosses the end of a row.
+bool TGAImage::load_rle_data(const std::uint8_t *in, const std::uint8_t *end, const bool flip_rows) {
+    const size_t rowbytes = static_cast<size_t>(w)*bpp;
+    int row = 0;
+    size_t column = 0;
+    while (row < h) {
+        if (in >= end) return false;
+        const std::uint8_t chunkheader = *in++;
+        const bool run = chunkheader >= 128;
+        size_t remaining = (run ? chunkheader-127 : chunkheader+1)*bpp;
+        if (static_cast<size_t>(end-in) < (run ? bpp : remaining)) return false;
+
+        while (remaining > 0) {
+            if (row >= h) {
+                std::cerr << "Too many pixels read\n";
                 return false;
             }
-            for (int i=0; i<chunkheader; i++) {
-                for (int t=0; t<bpp; t++)
-                    data[currentbyte++] = colorbuffer.bgra[t];
-                currentpixel++;
-                if (currentpixel>pixelcount) {
-                    std::cerr << "Too many pixels read\n";
-                    return false;
-                }
+            std::uint8_t *dst = data.data() + (flip_rows ? h-1-row : row)*rowbytes + column;
+            const size_t count = std::min(remaining, rowbytes-column);
+            if (!run) {
+                memcpy(dst, in, count);
+                in += count;
+            } else {
+                memcpy(dst, in, bpp);
+                for (size_t filled=bpp; filled<count; filled*=2)
+                    memcpy(dst+filled, dst, std::min(filled, count-filled));
+            }
+            remaining -= count;
+            column += count;
+            if (column == rowbytes) {
+                column = 0;
+                row++;
             }
         }
-    } while (currentpixel < pixelcount);
+        if (run) in += bpp;
+    }
     return true;
 }
 
@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <fstream>
 #include <vector>
+#include "../Utils/AlignedAllocator.h"
 
 #pragma pack(push,1)
 struct TGAHeader {
@@ -30,7 +31,8 @@ struct TGAImage {
     enum Format { GRAYSCALE=1, RGB=3, RGBA=4 };
     TGAImage() = default;
     TGAImage(const int w, const int h, const int bpp);
-    bool  read_tga_file(const std::string filename);
+    // vflip stores the rows bottom-up (row 0 is the bottom of the picture), the same as read + flip_vertically.
+    bool  read_tga_file(const std::string filename, const bool vflip=false);
     bool write_tga_file(const std::string filename, const bool vflip=true, const bool rle=true) const;
     void flip_horizontally();
     void flip_vertically();
@@ -39,11 +41,12 @@ struct TGAImage {
     int width()  const;
     int height() const;
     std::uint8_t* buffer() { return data.data(); }
+    std::size_t buffer_size() const { return data.size(); }
 private:
-    bool   load_rle_data(std::ifstream &in);
+    bool   load_rle_data(const std::uint8_t *in, const std::uint8_t *end, const bool flip_rows);
     bool unload_rle_data(std::ofstream &out) const;
     int w = 0, h = 0;
     std::uint8_t bpp = 0;
-    std::vector<std::uint8_t> data = {};
+    AlignedVector<std::uint8_t> data = {};
 };
 
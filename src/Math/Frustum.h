@@ -0,0 +1,74 @@
+#ifndef RENDERER_FRUSTUM_H
+#define RENDERER_FRUSTUM_H
+
+#include "Matrix.h"
+#include <cmath>
+
+/**
+ * Plane as normal . p + d = 0, the normal points to the inside.
+ */
+struct Plane {
+    Vec3f normal;
+    float d = 0.0f;
+
+    [[nodiscard]] float distance(const Vec3f& p) const { return dotProduct(normal, p) + d; }
+};
+
+/**
+ * Culling volume extracted from a projection * view matrix (Gribb-Hartmann).
+ * A point is visible if -w <= x <= w, -w <= y <= w and w > 0 in clip space.
+ * There is no far plane - the projections used here have no far clip.
+ */
+struct Frustum {
+    static constexpr int PLANE_COUNT = 5;
+    Plane planes[PLANE_COUNT];
+
+    /**
+     * @brief Extracts the planes in the space the matrix transforms from.
+     *        Pass projection * view for world space planes.
+     *
+     * @param viewProj - Column-major clip transform.
+     * @return Normalized, inward facing planes.
+     */
+    static Frustum fromMatrix(const Matrix4f4& viewProj)
+    {
+        // Row r of a column-major matrix is (m[0][r], m[1][r], m[2][r], m[3][r]).
+        auto row = [&viewProj](const int r) {
+            return Vec4f(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]);
+        };
+        const Vec4f x = row(0), y = row(1), w = row(3);
+        const Vec4f rows[PLANE_COUNT] = { w + x, w - x, w + y, w - y, w };
+
+        Frustum frustum;
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            const Vec3f normal(rows[i][0], rows[i][1], rows[i][2]);
+            const float length = normal.length();
+            const float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+            frustum.planes[i] = { normal * invLength, rows[i][3] * invLength };
+        }
+        return frustum;
+    }
+
+    // Conservative: true unless the sphere is fully outside a plane.
+    [[nodiscard]] bool intersectsSphere(const Vec3f& center, const float radius) const
+    {
+        for (const auto& plane : planes) {
+            if (plane.distance(center) < -radius) return false;
+        }
+        return true;
+    }
+
+    // Conservative: true unless the box is fully outside a plane (tests the corner furthest inside).
+    [[nodiscard]] bool intersectsAABB(const Vec3f& min, const Vec3f& max) const
+    {
+        for (const auto& plane : planes) {
+            const Vec3f positive(plane.normal.x() >= 0.0f ? max.x() : min.x(),
+                                 plane.normal.y() >= 0.0f ? max.y() : min.y(),
+                                 plane.normal.z() >= 0.0f ? max.z() : min.z());
+            if (plane.distance(positive) < 0.0f) return false;
+        }
+        return true;
+    }
+};
+
+#endif //RENDERER_FRUSTUM_H
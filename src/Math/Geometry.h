@@ -2,7 +2,9 @@
 #define RENDERER_GEOMETRY_H
 
 #include <iostream>
+#include <span>
 #include "Vec.h"
+#include "../Utils/AlignedAllocator.h"
 
 struct BBox {
     Point3 _boxMin{}, _boxMax{};
@@ -29,20 +31,111 @@ struct Face {
     }
 
     /**
+     * A missing normal (index -1) takes the face normal, a missing uv is (0, 0).
      *
      * @param modelVertices   structure contains the OBJ file vertices.
      * @param modelNormals  structure contains the OBJ normals indices.
      * @param modelTexture  structure contains the OBJ texture indices.
      */
-    void updateFace(const std::vector<Point3>& modelVertices,
-                    const std::vector<Point3>& modelNormals,
-                    const std::vector<Vec2f>& modelTexture) {
+    void updateFace(const std::span<const Point3> modelVertices,
+                    const std::span<const Point3> modelNormals,
+                    const std::span<const Vec2f> modelTexture) {
         for(int i = 0; i < 3; i++) {
             pts[i] = modelVertices[vertexIndices[i]];
-            normals[i] = modelNormals[normalIndices[i]];
-            uv[i] = modelTexture[textureIndices[i]];
+        }
+
+        Vec3f flatNormal = cross(pts[1] - pts[0], pts[2] - pts[0]);
+        if (flatNormal.lengthSquared() > 0.0f) flatNormal = flatNormal.normalize();
+
+        for(int i = 0; i < 3; i++) {
+            normals[i] = normalIndices[i] >= 0 ? modelNormals[normalIndices[i]] : flatNormal;
+            uv[i] = textureIndices[i] >= 0 ? modelTexture[textureIndices[i]] : Vec2f();
         }
     }
 };
 
+// Per-face tangent frame for normal mapping.
+struct TangentBasis {
+    Vec3f tangent;
+    Vec3f bitangent;
+};
+
+/**
+ * @brief                    Calculates the TBN basis for a triangle.
+ *               The calculation requires both the triangle vertices
+ *                            and the UV coordinates for each vertex.
+ *            The TBN matrix is used for correct normal calculations
+ *                                     as well as correct UV mapping.
+ *
+ * @param pts                                    Triangle 3 vertices.
+ * @param uvs                              Triangle 3 UV coordinates.
+ * @return                     Returns the new tangent and bitangent.
+ */
+inline TangentBasis calculateTriangleBasis(const Vec3f pts[3], const Vec2f uvs[3])
+{
+    Vec3f edge1 = pts[1] - pts[0];
+    Vec3f edge2 = pts[2] - pts[0];
+
+    Vec2f deltaUV1 = uvs[1] - uvs[0];
+    Vec2f deltaUV2 = uvs[2] - uvs[0];
+
+    const float f = 1.0f / (deltaUV1.x() * deltaUV2.y() - deltaUV2.x() * deltaUV1.y());
+
+    Vec3f tangent, bitangent;
+    tangent.x() = f * (deltaUV2.y() * edge1.x() - deltaUV1.y() * edge2.x());
+    tangent.y() = f * (deltaUV2.y() * edge1.y() - deltaUV1.y() * edge2.y());
+    tangent.z() = f * (deltaUV2.y() * edge1.z() - deltaUV1.y() * edge2.z());
+
+    bitangent.x() = f * (-deltaUV2.x() * edge1.x() + deltaUV1.x() * edge2.x());
+    bitangent.y() = f * (-deltaUV2.x() * edge1.y() + deltaUV1.x() * edge2.y());
+    bitangent.z() = f * (-deltaUV2.x() * edge1.z() + deltaUV1.x() * edge2.z());
+
+    return {tangent.normalize(), bitangent.normalize()};
+}
+
+// Vertices [begin, end) of a mesh.
+struct VertexRange {
+    int begin = 0;
+    int end = 0;
+};
+
+constexpr int MESHLET_VERTEX_RANGES = 4;
+
+/**
+ * A cluster of up to MESHLET_SIZE neighbouring faces with a similar orientation,
+ * the unit the geometry stage culls before any per-vertex work.
+ * Bounds are in model space, faces are [firstFace, firstFace + faceCount).
+ */
+struct Meshlet {
+    int firstFace = 0;
+    int faceCount = 0;
+
+    // Runs of vertex indices covering every vertex the faces use, sorted and disjoint.
+    VertexRange vertexRanges[MESHLET_VERTEX_RANGES];
+    int vertexRangeCount = 0;
+
+    Point3 center;                  // bounding sphere of the faces.
+    float radius = 0.0f;
+
+    // Normal cone - every face normal is within the cone around coneAxis whose
+    // half angle has the sine coneCutoff. 1 means the faces spread too wide for a cone.
+    Vec3f coneAxis;
+    float coneCutoff = 1.0f;
+};
+
+constexpr int MESHLET_SIZE = 64;
+
+/**
+ * Vertex positions of a mesh as separate coordinate arrays (SoA), indexed like
+ * the mesh's vertices. Shared by every instance of the mesh, so transforming
+ * them per instance runs over contiguous floats the compiler can vectorize.
+ */
+struct VertexStreams {
+    AlignedVector<float> x;
+    AlignedVector<float> y;
+    AlignedVector<float> z;
+
+    [[nodiscard]] int size() const { return static_cast<int>(x.size()); }
+};
+
 #endif //RENDERER_GEOMETRY_H
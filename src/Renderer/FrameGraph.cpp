@@ -0,0 +1,81 @@
+#include "FrameGraph.h"
+#include "../Utils/TaskGroup.h"
+
+#include <atomic>
+#include <memory>
+
+void FrameGraph::addPass(std::string name, const std::uint32_t reads, const std::uint32_t writes,
+                         std::function<void()> run)
+{
+    passes.push_back({ std::move(name), reads, writes, std::move(run) });
+}
+
+void FrameGraph::compile()
+{
+    const int count = passCount();
+
+    // reach[i][j]: pass j has to wait for pass i (directly or not).
+    std::vector<std::vector<bool>> reach(count, std::vector<bool>(count, false));
+    for (int j = 0; j < count; ++j) {
+        for (int i = 0; i < j; ++i) {
+            const Pass& a = passes[i];
+            const Pass& b = passes[j];
+            const bool hazard = (a.writes & (b.reads | b.writes)) || (a.reads & b.writes);
+            if (!hazard) continue;
+
+            reach[i][j] = true;
+            for (int k = 0; k < i; ++k) {
+                if (reach[k][i]) reach[k][j] = true;
+            }
+        }
+    }
+
+    for (auto& pass : passes) {
+        pass.dependencies.clear();
+        pass.dependents.clear();
+    }
+
+    // Keep i -> j only if no pass in between already orders them.
+    for (int j = 0; j < count; ++j) {
+        for (int i = 0; i < j; ++i) {
+            if (!reach[i][j]) continue;
+
+            bool implied = false;
+            for (int k = i + 1; k < j && !implied; ++k) {
+                implied = reach[i][k] && reach[k][j];
+            }
+            if (implied) continue;
+
+            passes[j].dependencies.push_back(i);
+            passes[i].dependents.push_back(j);
+        }
+    }
+}
+
+void FrameGraph::execute(ThreadPool& pool)
+{
+    compile();
+
+    const int count = passCount();
+    std::unique_ptr<std::atomic<int>[]> remaining(new std::atomic<int>[count]);
+    for (int i = 0; i < count; ++i) {
+        remaining[i].store(static_cast<int>(passes[i].dependencies.size()), std::memory_order_relaxed);
+    }
+
+    TaskGroup group(pool);
+
+    // Runs a pass, then launches every dependent whose last dependency it was.
+    std::function<void(int)> launch = [&](const int index) {
+        group.run([&, index] {
+            passes[index].run();
+            for (const int next : passes[index].dependents) {
+                if (remaining[next].fetch_sub(1, std::memory_order_acq_rel) == 1) launch(next);
+            }
+        });
+    };
+
+    for (int i = 0; i < count; ++i) {
+        if (passes[i].dependencies.empty()) launch(i);
+    }
+    group.wait();
+}
@@ -0,0 +1,79 @@
+#ifndef RENDERER_FRAMEGRAPH_H
+#define RENDERER_FRAMEGRAPH_H
+
+#include "../Utils/ThreadPool.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/**
+ * Resources a pass can read or write, combined as a bit mask.
+ * The geometry entries are the binned triangles of a pass (see BinnedGeometry).
+ */
+namespace FrameResource {
+    enum : std::uint32_t {
+        None             = 0,
+        ShadowGeometry   = 1u << 0,
+        ShadowMap        = 1u << 1,
+        ColorGeometry    = 1u << 2,
+        ZBuffer          = 1u << 3,
+        ColorBuffer      = 1u << 4,
+        NormalBuffer     = 1u << 5,
+        OcclusionDepth   = 1u << 6,     // the depth pyramid built from ZBuffer.
+    };
+}
+
+/**
+ * Minimal frame graph. Passes are added in the order a serial renderer
+ * would run them, together with the resources they read and write.
+ * A pass depends on an earlier one only if they touch a common resource
+ * and at least one of them writes it - every other pair of passes may run
+ * concurrently. execute() runs each pass on the pool as soon as the passes
+ * it depends on are done.
+ */
+class FrameGraph {
+public:
+    /**
+     * @brief Adds a pass to the graph.
+     *
+     * @param name                              pass name, for debugging.
+     * @param reads                    FrameResource mask the pass reads.
+     * @param writes                  FrameResource mask the pass writes.
+     * @param run                               the work of the pass.
+     */
+    void addPass(std::string name, std::uint32_t reads, std::uint32_t writes, std::function<void()> run);
+
+    /**
+     * @brief Builds the dependencies and runs all the passes, returns once all are done.
+     *        May be called from a pool task.
+     */
+    void execute(ThreadPool& pool = ThreadPool::instance());
+
+    /**
+     * @brief Computes the dependencies between the passes, execute() calls it.
+     *        Edges implied by others (a -> b -> c makes a -> c redundant)
+     *        are dropped, so every remaining edge is a required barrier.
+     */
+    void compile();
+
+    // Passes that must finish before the given pass starts, valid after compile().
+    [[nodiscard]] const std::vector<int>& dependenciesOf(int pass) const { return passes[pass].dependencies; }
+    [[nodiscard]] int passCount() const { return static_cast<int>(passes.size()); }
+
+private:
+    struct Pass {
+        std::string name;
+        std::uint32_t reads = 0;
+        std::uint32_t writes = 0;
+        std::function<void()> run;
+
+        std::vector<int> dependencies{};
+        std::vector<int> dependents{};
+    };
+
+    std::vector<Pass> passes;
+};
+
+#endif //RENDERER_FRAMEGRAPH_H
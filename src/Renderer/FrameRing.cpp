@@ -0,0 +1,159 @@
+#include "FrameRing.h"
+#include "../Utils/TaskGroup.h"
+#include <algorithm>
+#include <utility>
+
+FrameRing::FrameRing(const int width, const int height, const int shadowW, const int shadowH,
+                     const PixelFormat format, const int ringSize)
+    : slots(std::max(1, ringSize)), format(format), maxFramesInFlight(std::max(1, ringSize))
+{
+    for (auto& slot : slots) {
+        slot.buffers = std::make_unique<RenderBuffers>(width, height, shadowW, shadowH, format);
+    }
+    renderThread = std::thread([this] { renderLoop(); });
+}
+
+FrameRing::~FrameRing()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobCondition.notify_all();
+    renderThread.join();
+}
+
+bool FrameRing::submit(SceneSnapshot scene, const int width, const int height, const Clock::time_point inputTime)
+{
+    if (!scene) return false;
+
+    // Frames render one at a time, they all share the global pool. Pipelining
+    // adds one frame whose geometry is built while the other one rasterizes.
+    const int maxRendering = pipelineMode == PipelineMode::Throughput ? 2 : 1;
+
+    int inFlight = 0;
+    int rendering = 0;
+    Slot* freeSlot = nullptr;
+    for (auto& slot : slots) {
+        const SlotState state = slot.state.load(std::memory_order_acquire);
+        if (state == SlotState::Rendering) rendering++;
+        if (state == SlotState::Ready) inFlight++;
+        if (state == SlotState::Free && !freeSlot) freeSlot = &slot;
+    }
+
+    if (!freeSlot || rendering >= maxRendering || inFlight >= maxFramesInFlight) return false;
+
+    freeSlot->state.store(SlotState::Rendering, std::memory_order_relaxed);
+    freeSlot->frameIndex = nextFrameIndex++;
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobs.push_back({ freeSlot, std::move(scene), width, height, inputTime });
+    }
+    jobCondition.notify_one();
+    return true;
+}
+
+bool FrameRing::popJob(Job& job)
+{
+    std::unique_lock<std::mutex> lock(jobMutex);
+    jobCondition.wait(lock, [this] { return stopping || !jobs.empty(); });
+    if (stopping) return false;
+
+    job = std::move(jobs.front());
+    jobs.pop_front();
+    return true;
+}
+
+bool FrameRing::tryPopJob(Job& job)
+{
+    std::lock_guard<std::mutex> lock(jobMutex);
+    if (stopping || jobs.empty()) return false;
+
+    job = std::move(jobs.front());
+    jobs.pop_front();
+    return true;
+}
+
+void FrameRing::finishJob(Job& job)
+{
+    job.slot->buffers->stats.inputTime = job.inputTime;
+    job.scene.reset();
+    job.slot->state.store(SlotState::Ready, std::memory_order_release);
+}
+
+void FrameRing::renderLoop()
+{
+    Job job;
+    PreparedFrame frame;
+    // The geometry of 'job' was already built while the previous frame rasterized.
+    bool prepared = false;
+
+    while (prepared || popJob(job)) {
+        RenderBuffers& target = *job.slot->buffers;
+
+        if (!prepared && pipelineMode == PipelineMode::Latency) {
+            target.resize(job.width, job.height);
+            Renderer::render(*job.scene, target, &occluders);
+            std::swap(occluders, target.depthPyramid);
+            finishJob(job);
+            continue;
+        }
+
+        if (!prepared) {
+            target.resize(job.width, job.height);
+            Renderer::prepare(*job.scene, target, frame, &occluders);
+        }
+
+        // A frame submitted meanwhile gets its geometry built during this raster.
+        Job next;
+        const bool overlap = tryPopJob(next);
+
+        PreparedFrame nextFrame;
+        {
+            TaskGroup group;
+            if (overlap) {
+                group.run([&] {
+                    next.slot->buffers->resize(next.width, next.height);
+                    Renderer::prepare(*next.scene, *next.slot->buffers, nextFrame, &occluders);
+                });
+            }
+            Renderer::rasterize(frame, target);
+        }
+        frame = std::move(nextFrame);
+        std::swap(occluders, target.depthPyramid);
+
+        finishJob(job);
+
+        prepared = overlap;
+        if (overlap) job = std::move(next);
+    }
+}
+
+const RenderBuffers* FrameRing::acquireReady()
+{
+    const Slot* oldest = nullptr;
+    for (const auto& slot : slots) {
+        if (slot.state.load(std::memory_order_acquire) == SlotState::Ready &&
+            (!oldest || slot.frameIndex < oldest->frameIndex)) {
+            oldest = &slot;
+        }
+    }
+    return oldest ? oldest->buffers.get() : nullptr;
+}
+
+void FrameRing::release(const RenderBuffers* frame)
+{
+    for (auto& slot : slots) {
+        if (slot.buffers.get() == frame) {
+            slot.state.store(SlotState::Free, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+void FrameRing::setMaxFramesInFlight(const int frames)
+{
+    maxFramesInFlight = std::clamp(frames, 1, size());
+}
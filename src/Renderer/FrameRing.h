@@ -0,0 +1,123 @@
+#ifndef RENDERER_FRAMERING_H
+#define RENDERER_FRAMERING_H
+
+#include "Renderer.h"
+#include "SceneSnapshots.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * A ring of render targets used to overlap the CPU rasterizer with presentation.
+ * Frames are rendered by a dedicated render thread (using the pool), the main
+ * thread only submits scene snapshots and uploads finished frames, so a slow
+ * frame never stalls event polling or the UI.
+ * While frame N is uploaded and presented by the main thread, frame N+1 is
+ * already rendering into another slot.
+ * The number of frames rendered but not yet presented is bounded by
+ * maxFramesInFlight, which bounds the added latency.
+ *
+ * In Throughput mode the frames are pipelined as well: the geometry of
+ * frame N+1 is built (Renderer::prepare) while frame N still rasterizes,
+ * from the scene snapshot given to submit. Frames still finish in order.
+ * Latency mode renders one frame at a time, which keeps input-to-display
+ * latency lowest for interactive use.
+ *
+ * The depth pyramid of the last finished frame is kept as the occluders of
+ * the next one. A pipelined frame culls against the frame before the one
+ * rasterizing alongside it, which is why Renderer checks the camera motion.
+ *
+ * All the public methods must be called from the same (main) thread.
+ */
+class FrameRing {
+public:
+    enum class PipelineMode { Latency, Throughput };
+    using Clock = std::chrono::steady_clock;
+
+    FrameRing(int width, int height, int shadowW, int shadowH, PixelFormat format, int ringSize);
+    ~FrameRing();
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    /**
+     * @brief Queues a scene snapshot to be rendered into a free slot by the render thread.
+     *        Never blocks - nothing is submitted while a frame is still rendering
+     *        (two in Throughput mode) or while maxFramesInFlight frames are
+     *        waiting to be presented.
+     *
+     * @param scene        Snapshot to render, kept alive until the frame is done.
+     * @param width                 Render resolution of this frame, the
+     * @param height              slot is resized if it differs (see RenderBuffers::resize).
+     * @param inputTime     When the input this frame reflects was sampled,
+     *                          reported back in the frame's stats.inputTime.
+     * @return                        true if a new frame was submitted.
+     */
+    bool submit(SceneSnapshot scene, int width, int height, Clock::time_point inputTime = Clock::now());
+
+    /**
+     * @brief Never blocks.
+     * @return The oldest finished frame not yet presented, or nullptr.
+     */
+    const RenderBuffers* acquireReady();
+
+    /**
+     * @brief Returns a frame from acquireReady to the ring once it was uploaded.
+     */
+    void release(const RenderBuffers* frame);
+
+    void setPipelineMode(PipelineMode mode) { pipelineMode = mode; }
+    [[nodiscard]] PipelineMode getPipelineMode() const { return pipelineMode; }
+
+    void setMaxFramesInFlight(int frames);
+    [[nodiscard]] int getMaxFramesInFlight() const { return maxFramesInFlight; }
+    [[nodiscard]] int size() const { return static_cast<int>(slots.size()); }
+    [[nodiscard]] PixelFormat colorFormat() const { return format; }
+
+private:
+    // Rendering covers both queued and in-progress frames.
+    enum class SlotState { Free, Rendering, Ready };
+
+    struct Slot {
+        std::unique_ptr<RenderBuffers> buffers;
+        std::atomic<SlotState> state = SlotState::Free;
+        std::uint64_t frameIndex = 0;
+    };
+
+    struct Job {
+        Slot* slot = nullptr;
+        SceneSnapshot scene;
+        int width = 0;
+        int height = 0;
+        Clock::time_point inputTime;
+    };
+
+    void renderLoop();
+    // Blocks until a job is queued, false once the ring is shutting down.
+    bool popJob(Job& job);
+    bool tryPopJob(Job& job);
+    void finishJob(Job& job);
+
+    std::vector<Slot> slots;
+    PixelFormat format;
+    int maxFramesInFlight;
+    std::atomic<PipelineMode> pipelineMode = PipelineMode::Latency;
+    std::uint64_t nextFrameIndex = 0;
+    // Only touched by the render thread.
+    DepthPyramid occluders;
+
+    std::mutex jobMutex;
+    std::condition_variable jobCondition;
+    std::deque<Job> jobs;
+    bool stopping = false;
+    std::thread renderThread;
+};
+
+#endif //RENDERER_FRAMERING_H
@@ -0,0 +1,87 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+float LodSelector::projectedSize(const AABB& box, const Matrix4f4& viewProj, const Vec3f& eye,
+                                 const int viewportHeight)
+{
+    const Vec3f center = (box.min + box.max) * 0.5f;
+    const float radius = (box.max - box.min).length() * 0.5f;
+
+    // Inside the bounding sphere the size is unbounded.
+    if ((center - eye).length() <= radius) return std::numeric_limits<float>::max();
+
+    const float w = (viewProj * Vec4f(center)).w();
+    if (w <= 0.0f) return 0.0f;
+
+    // The viewport maps [-1, 1] to the height, so a diameter of 2r / w in NDC is r * h / w pixels.
+    return radius * static_cast<float>(viewportHeight) / w;
+}
+
+int LodSelector::levelForSize(const ModelResource& resource, const float size) const
+{
+    const float area = 0.25f * static_cast<float>(M_PI) * size * size;
+    const float maxFaces = area / settings.pixelsPerFace;
+
+    const int levels = resource.lodCount();
+    for (int level = 0; level < levels - 1; ++level) {
+        if (static_cast<float>(resource.lod(level).getFaces().size()) <= maxFaces) return level;
+    }
+    return levels - 1;
+}
+
+void LodSelector::update(Scene& scene, const int viewportHeight)
+{
+    auto& models = scene.models;
+    faces = 0;
+    bySize.clear();
+
+    if (!enabled) {
+        for (auto& model : models) {
+            model.lod = 0;
+            if (model.resource) faces += static_cast<int>(model.resource->model.getFaces().size());
+        }
+        return;
+    }
+
+    const Camera& cam = scene.getActiveCamera();
+    const Matrix4f4 viewProj = Matrix4f4::projection(cam.focalLength) * Matrix4f4::lookat(cam.pos, cam.lookAt, cam.up);
+    const bool useBVH = scene.bvh.size() == models.size();
+    const float h = settings.hysteresis;
+
+    for (int i = 0; i < static_cast<int>(models.size()); ++i) {
+        auto& model = models[i];
+        if (!model.resource) continue;
+        const ModelResource& resource = *model.resource;
+
+        const AABB box = useBVH ? scene.bvh.bounds(i) : model.getWorldAABB();
+        const float size = projectedSize(box, viewProj, cam.pos, viewportHeight);
+
+        // Finer only if still wanted at a smaller size, coarser only if still wanted at a larger one.
+        int level = std::min(model.lod, resource.lodCount() - 1);
+        const int finer = levelForSize(resource, size * (1.0f - h));
+        const int coarser = levelForSize(resource, size * (1.0f + h));
+        if (finer < level) level = finer;
+        else if (coarser > level) level = coarser;
+
+        model.lod = level;
+        faces += static_cast<int>(resource.lod(level).getFaces().size());
+        bySize.emplace_back(size, i);
+    }
+
+    if (faces <= settings.faceBudget) return;
+
+    // Over budget - the smallest instances on screen drop to their coarsest level first.
+    std::sort(bySize.begin(), bySize.end());
+    for (const auto& [size, i] : bySize) {
+        if (faces <= settings.faceBudget) break;
+
+        auto& model = models[i];
+        const ModelResource& resource = *model.resource;
+        faces -= static_cast<int>(resource.lod(model.lod).getFaces().size());
+        model.lod = resource.lodCount() - 1;
+        faces += static_cast<int>(resource.lod(model.lod).getFaces().size());
+    }
+}
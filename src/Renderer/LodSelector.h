@@ -0,0 +1,53 @@
+#ifndef RENDERER_LODSELECTOR_H
+#define RENDERER_LODSELECTOR_H
+
+#include "Scene.h"
+#include <vector>
+
+/**
+ * Picks the level of detail of every model from its projected size.
+ * A level is used once its faces would cover at least pixelsPerFace pixels each,
+ * so far away instances stop pushing sub-pixel triangles through the pipeline.
+ * Levels change only when the size leaves a hysteresis band, so an instance
+ * near a threshold does not flicker between two levels.
+ * If the scene still exceeds faceBudget, the smallest instances on screen are
+ * made coarser first, which keeps the triangle count bounded as instances are added.
+ */
+class LodSelector {
+public:
+    struct Settings {
+        float pixelsPerFace = 8.0f;
+        float hysteresis = 0.15f;       // relative size change needed to switch level.
+        int faceBudget = 300000;
+    };
+
+    LodSelector() = default;
+    explicit LodSelector(const Settings& settings) : settings(settings) {}
+
+    /**
+     * @brief Writes ModelInstance::lod of every model, call before publishing the scene.
+     *
+     * @param scene                  Its models and active camera are used.
+     * @param viewportHeight                   Render height in pixels.
+     */
+    void update(Scene& scene, int viewportHeight);
+
+    /**
+     * @brief Projected diameter of a world box in pixels, 0 when behind the camera.
+     */
+    static float projectedSize(const AABB& box, const Matrix4f4& viewProj, const Vec3f& eye, int viewportHeight);
+
+    // Faces of all the models at their selected level, after the last update.
+    [[nodiscard]] int selectedFaces() const { return faces; }
+
+    Settings settings;
+    bool enabled = true;
+
+private:
+    [[nodiscard]] int levelForSize(const ModelResource& resource, float size) const;
+
+    std::vector<std::pair<float, int>> bySize;
+    int faces = 0;
+};
+
+#endif //RENDERER_LODSELECTOR_H
@@ -1,66 +1,252 @@
 #include "Renderer.h"
-#include "../Shaders/PhongShader.h"
-#include "../Shaders/DepthShader.h"
-#include "../Utils/ThreadPool.h"
+#include "../Utils/TaskGroup.h"
+#include "FrameGraph.h"
+#include "../Math/Frustum.h"
+#include <chrono>
 #include <iostream>
 #include <thread>
 
-void Renderer::render(const Scene& scene, RenderBuffers& target)
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    float millisSince(const Clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
+
+    // Bounding sphere first (cheap reject), then the box itself.
+    bool isVisible(const Frustum& frustum, const AABB& box)
+    {
+        const Vec3f center = (box.min + box.max) * 0.5f;
+        const float radius = (box.max - box.min).length() * 0.5f;
+
+        return frustum.intersectsSphere(center, radius) && frustum.intersectsAABB(box.min, box.max);
+    }
+
+    // Indices of the models intersecting the frustum, in scene order.
+    void collectVisible(const Scene& scene, const Frustum& frustum, std::vector<int>& visible)
+    {
+        if (scene.bvh.size() == scene.models.size()) {
+            scene.bvh.queryFrustum(frustum, visible);
+            return;
+        }
+
+        visible.clear();
+        for (int i = 0; i < static_cast<int>(scene.models.size()); ++i) {
+            if (isVisible(frustum, scene.models[i].getWorldAABB())) visible.push_back(i);
+        }
+    }
+
+    void writeCullStats(const PreparedFrame& frame, RenderStats& stats)
+    {
+        stats.instances = frame.instances;
+        stats.culledInstances = frame.culledInstances;
+        stats.shadowCulledInstances = frame.shadowCulledInstances;
+        stats.occludedInstances = frame.occludedInstances;
+        stats.meshlets = frame.colorGeometry.meshlets;
+        stats.culledMeshlets = frame.colorGeometry.culledMeshlets;
+    }
+}
+
+void Renderer::render(const Scene& scene, RenderBuffers& target, const DepthPyramid* occluders)
+{
+    const auto frameStart = Clock::now();
+
+    PreparedFrame frame;
+    frame.occluders = occluders;
+    target.reset();
+
+    // A single graph, so the color pass vertex processing overlaps the shadow raster.
+    FrameGraph graph;
+    addGeometryPasses(graph, scene, target, frame);
+    addRasterPasses(graph, frame, target);
+    graph.execute();
+
+    target.stats = { millisSince(frameStart) };
+    writeCullStats(frame, target.stats);
+}
+
+void Renderer::prepare(const Scene& scene, RenderBuffers& target, PreparedFrame& frame,
+                       const DepthPyramid* occluders)
+{
+    const auto start = Clock::now();
+
+    // Rebuilt from scratch, leftover shaders would pile up and move under the draw calls.
+    frame = PreparedFrame{};
+    frame.occluders = occluders;
+
+    FrameGraph graph;
+    addGeometryPasses(graph, scene, target, frame);
+    graph.execute();
+
+    target.stats.geometryMs = millisSince(start);
+    writeCullStats(frame, target.stats);
+}
+
+void Renderer::rasterize(const PreparedFrame& frame, RenderBuffers& target)
+{
+    const auto start = Clock::now();
+
+    target.reset();
+
+    FrameGraph graph;
+    addRasterPasses(graph, frame, target);
+    graph.execute();
+
+    // Work time of the frame, the time spent waiting between the halves is not counted.
+    target.stats.rasterMs = millisSince(start);
+    target.stats.renderMs = target.stats.geometryMs + target.stats.rasterMs;
+}
+
+void Renderer::addGeometryPasses(FrameGraph& graph, const Scene& scene,
+                                 RenderBuffers& target, PreparedFrame& frame)
 {
     const Matrix4f4 lightView = Matrix4f4::lookat(scene.lightPos, Vec3f(0.0f, 0.0f, 0.0f), Vec3f(0.0f, 1.0f, 0.0f));
     const Matrix4f4 lightProj = Matrix4f4::projection(LIGHT_PROJECTION_SIZE);
-    const Matrix4f4 lightProjView = lightProj * lightView;
 
-    target.reset();
+    const Camera& cam = scene.getActiveCamera();
+    frame.viewProj = Matrix4f4::projection(cam.focalLength) * Matrix4f4::lookat(cam.pos, cam.lookAt, cam.up);
+    frame.cameraPos = cam.pos;
+    frame.cameraDir = (cam.lookAt - cam.pos).normalize();
+
+    frame.lightProjView = lightProj * lightView;
+    frame.instances = static_cast<int>(scene.models.size());
+    frame.useShadows = scene.useShadows;
+    frame.useSSAO = scene.useSSAO;
+    frame.useOcclusionCulling = scene.useOcclusionCulling;
+    frame.occluders = frame.useOcclusionCulling ? usableOccluders(frame.occluders, frame) : nullptr;
+
     // --- STEP 1: Shadow Pass ---
-    if (scene.useShadows) {
-        runShadowPass(scene, target, lightProjView);
+    if (frame.useShadows) {
+        graph.addPass("shadow geometry", FrameResource::None, FrameResource::ShadowGeometry, [&] {
+            buildShadowGeometry(scene, target, frame);
+        });
     }
 
     // --- STEP 2: Fill Z-Buffer (Crucial for SSAO) ---
-    runColorPass(scene, target, lightProjView);
+    // Vertex processing does not need the shadow map.
+    graph.addPass("color geometry", FrameResource::None, FrameResource::ColorGeometry, [&] {
+        buildColorGeometry(scene, target, frame);
+    });
+}
+
+void Renderer::addRasterPasses(FrameGraph& graph, const PreparedFrame& frame, RenderBuffers& target)
+{
+    if (frame.useShadows) {
+        graph.addPass("shadow raster", FrameResource::ShadowGeometry, FrameResource::ShadowMap, [&] {
+            const RenderContext ctx = { target.shadowMap, nullptr, nullptr,
+                                        target.shadowW, target.shadowH, &target.shadowTiles };
+            rasterizeGeometry(ctx, frame.shadowGeometry);
+            resolveUntouchedTiles(ctx);
+        });
+    }
+
+    graph.addPass("color raster", FrameResource::ColorGeometry | FrameResource::ShadowMap,
+                  FrameResource::ZBuffer | FrameResource::ColorBuffer | FrameResource::NormalBuffer, [&] {
+        const RenderContext ctx = { target.zbuffer, &target.colorBuffer, &target.normalBuffer,
+                                    target.width, target.height, &target.colorTiles, target.colorFormat };
+        rasterizeGeometry(ctx, frame.colorGeometry);
+        resolveUntouchedTiles(ctx);
+    });
 
     // --- STEP 3: Apply SSAO ---
-    if (scene.useSSAO) {
-        applySSAO(target);
+    if (frame.useSSAO) {
+        graph.addPass("ssao", FrameResource::ZBuffer | FrameResource::ColorBuffer, FrameResource::ColorBuffer, [&] {
+            applySSAO(target);
+        });
     }
+
+    // Occluders of the next frame, SSAO only changes colors so it can run alongside.
+    graph.addPass("depth pyramid", FrameResource::ZBuffer, FrameResource::OcclusionDepth, [&] {
+        if (frame.useOcclusionCulling) {
+            target.depthPyramid.build(target.zbuffer, target.width, target.height,
+                                      frame.viewProj, frame.cameraPos, frame.cameraDir);
+        } else {
+            target.depthPyramid.invalidate();
+        }
+    });
 }
 
-void Renderer::runShadowPass(const Scene& scene,
-                             RenderBuffers &target,
-                             const Matrix4f4& lightProjView)
+const DepthPyramid* Renderer::usableOccluders(const DepthPyramid* occluders, const PreparedFrame& frame)
+{
+    if (!occluders || !occluders->isValid()) return nullptr;
+
+    const float moved = (frame.cameraPos - occluders->getCameraPos()).length();
+    const float turned = dotProduct(frame.cameraDir, occluders->getCameraDir());
+    if (moved > OCCLUSION_MAX_CAMERA_MOVE || turned < OCCLUSION_MAX_CAMERA_TURN_COS) return nullptr;
+
+    return occluders;
+}
+
+void Renderer::buildShadowGeometry(const Scene& scene,
+                                   RenderBuffers& target,
+                                   PreparedFrame& frame)
 {
 
     const Matrix4f4 lightViewport = Matrix4f4::viewport(0, 0, target.shadowW, target.shadowH);
+    // Only casters inside the light frustum can land in the shadow map.
+    const Frustum lightFrustum = Frustum::fromMatrix(frame.lightProjView);
+
+    auto& shaders = frame.depthShaders;
+    std::vector<DrawCall> draws;
+    shaders.reserve(scene.models.size());
+    draws.reserve(scene.models.size());
 
-    for (const auto& object : scene.models) {
+    std::vector<int> visible;
+    collectVisible(scene, lightFrustum, visible);
+    frame.shadowCulledInstances = static_cast<int>(scene.models.size() - visible.size());
+
+    for (const int index : visible) {
+        const auto& object = scene.models[index];
         Uniforms depthUniforms;
         depthUniforms.projection = Matrix4f4::identity();
         depthUniforms.viewport = lightViewport;
 
         Matrix4f4 modelMat = object.getModelMatrix();
-        depthUniforms.modelView = lightProjView * modelMat;
-
-        DepthShader depthShader(depthUniforms);
+        depthUniforms.modelView = frame.lightProjView * modelMat;
 
-        const RenderContext ctx = { object.resource->model, target.shadowMap,
-                          nullptr, nullptr,
-                              target.shadowW, target.shadowH };
-        drawModel(ctx, depthShader);
+        shaders.emplace_back(depthUniforms);
+        draws.push_back({ &object.resource->lod(object.lod), &shaders.back() });
     }
+
+    frame.shadowGeometry = processGeometry(draws, target.shadowW, target.shadowH, target.shadowScratch);
 }
 
-void Renderer::runColorPass(const Scene& scene,
-                  RenderBuffers& target,
-                  const Matrix4f4& lightProjView)
+void Renderer::buildColorGeometry(const Scene& scene,
+                                  RenderBuffers& target,
+                                  PreparedFrame& frame)
 {
 
     const Camera &cam = scene.getActiveCamera();
     const Matrix4f4 view = Matrix4f4::lookat(cam.pos, cam.lookAt, cam.up);
     const Matrix4f4 projection = Matrix4f4::projection(cam.focalLength);
     const Matrix4f4 viewport = Matrix4f4::viewport(0, 0, target.width, target.height);
+    const Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    auto& shaders = frame.phongShaders;
+    std::vector<DrawCall> draws;
+    shaders.reserve(scene.models.size());
+    draws.reserve(scene.models.size());
+
+    std::vector<int> visible;
+    collectVisible(scene, frustum, visible);
+    frame.culledInstances = static_cast<int>(scene.models.size() - visible.size());
+
+    const DepthPyramid* occluders = frame.occluders;
+    const bool useBVH = scene.bvh.size() == scene.models.size();
+    frame.occludedInstances = 0;
+
+    for (const int index : visible) {
+        const auto& object = scene.models[index];
+
+        if (occluders) {
+            const AABB box = useBVH ? scene.bvh.bounds(index) : object.getWorldAABB();
+            if (occluders->isOccluded(box.min, box.max, occluders->getViewProj())) {
+                frame.occludedInstances++;
+                continue;
+            }
+        }
 
-    for (const auto& object : scene.models) {
         Uniforms uniforms;
 
         uniforms.model = object.getModelMatrix();
@@ -70,7 +256,7 @@ void Renderer::runColorPass(const Scene& scene,
 
         uniforms.lightDir = scene.lightDir;
         uniforms.lightColor = scene.lightColor;
-        uniforms.lightProjView = lightProjView;
+        uniforms.lightProjView = frame.lightProjView;
         uniforms.shadowMap = scene.useShadows ? &target.shadowMap : nullptr;
         uniforms.shadowWidth = target.shadowW;
         uniforms.shadowHeight = target.shadowH;
@@ -78,15 +264,18 @@ void Renderer::runColorPass(const Scene& scene,
         uniforms.normalMatrix = uniforms.model.inverseTranspose3x3();
         uniforms.cameraPos = cam.pos;
 
-        PhongShader shader(object.resource->diffuse, object.resource->normal, object.resource->specular, uniforms,
-                           object.useAlphaTest, object.useDiffuse, object.useNormalMap, object.useSpecularMap,
-                           object.fillColor, object.useWireframe);
-
-        RenderContext ctx = { object.resource->model, target.zbuffer,
-                              &target.colorBuffer, &target.normalBuffer,
-                              target.width, target.height };
-        drawModel(ctx, shader);
+        shaders.emplace_back(*object.resource->diffuse, *object.resource->normal, *object.resource->specular, uniforms,
+                             object.useAlphaTest, object.useDiffuse, object.useNormalMap, object.useSpecularMap,
+                             object.fillColor, object.useWireframe);
+        DrawCall draw = { &object.resource->lod(object.lod), &shaders.back() };
+        if (occluders) {
+            draw.occluders = occluders;
+            draw.occluderClip = occluders->getViewProj() * uniforms.model;
+        }
+        draws.push_back(draw);
     }
+
+    frame.colorGeometry = processGeometry(draws, target.width, target.height, target.colorScratch);
 }
 
 void Renderer::applySSAO(RenderBuffers& target)
@@ -94,38 +283,27 @@ void Renderer::applySSAO(RenderBuffers& target)
     const int width = target.width;
     const int height = target.height;
 
-    std::uint8_t* rawFB = target.colorBuffer.data();
+    std::uint32_t* rawFB = target.colorBuffer.data();
 
     static std::vector<Vec2f> kernel;
     static std::vector<Vec2f> noise;
 
     initSSAOSamples(kernel, noise);
 
-    const unsigned int numThreads = std::max(1u, std::thread::hardware_concurrency());
-    const int rowsPerThread =  static_cast<int>(height / numThreads);
-
-    for (int t = 0; t < numThreads; ++t) {
-        ThreadPool::instance().enqueue([&, t]() {
-            const int startY = t * rowsPerThread;
-            const int endY = (t == numThreads - 1) ? height : (startY + rowsPerThread);
-            for (int y = startY; y < endY; y++) {
-                for (int x = 0; x < width; x++) {
-                    const int idx = x + y * width;
-                    const float intensity = computePixelOcclusion(x, y, width, height,
-                                                                  target.zbuffer, kernel, noise);
-
-                    if (intensity < 0.0f) continue;
-
-                    const int offset = idx * 3;
-                    rawFB[offset]     = static_cast<uint8_t>(rawFB[offset]     * intensity);
-                    rawFB[offset + 1] = static_cast<uint8_t>(rawFB[offset + 1] * intensity);
-                    rawFB[offset + 2] = static_cast<uint8_t>(rawFB[offset + 2] * intensity);
-                }
-            }
-        });
-    }
+    parallelFor(0, height, SSAO_ROW_GRAIN, [&](const int startY, const int endY) {
+        for (int y = startY; y < endY; y++) {
+            for (int x = 0; x < width; x++) {
+                const int idx = x + y * width;
+                const float intensity = computePixelOcclusion(x, y, width, height,
+                                                              target.zbuffer, kernel, noise);
+
+                if (intensity < 0.0f) continue;
 
-    ThreadPool::instance().waitFinished();
+                const auto factor = static_cast<std::uint32_t>(intensity * PackedColor::MODULATE_ONE);
+                rawFB[idx] = PackedColor::modulate(rawFB[idx], factor);
+            }
+        }
+    });
 }
 
 
@@ -146,7 +324,7 @@ void Renderer::initSSAOSamples(std::vector<Vec2f>& kernel, std::vector<Vec2f>& n
 
 float Renderer::computePixelOcclusion(const int x, const int y,
                                       const int width, const int height,
-                                      const std::vector<float>& zbuffer,
+                                      const AlignedVector<float>& zbuffer,
                                       const std::vector<Vec2f>& kernel,
                                       const std::vector<Vec2f>& noise)
 {
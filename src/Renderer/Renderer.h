@@ -5,75 +5,200 @@
 #include "../Core/IShader.h"
 #include "../IO/tgaimage.h"
 #include "../Core/Rasterizer.h"
+#include "../Core/DepthPyramid.h"
+#include "../Shaders/DepthShader.h"
+#include "../Shaders/PhongShader.h"
+#include <chrono>
 #include <vector>
 #include <limits>
 #include <cstdlib>
 
 
+/**
+ * Per-frame measurements, filled by Renderer::render and kept
+ * together with the frame they describe.
+ */
+struct RenderStats {
+    float renderMs = 0.0f;
+    float geometryMs = 0.0f;                 // only measured by Renderer::prepare.
+    float rasterMs = 0.0f;                   // only measured by Renderer::rasterize.
+    int instances = 0;
+    int culledInstances = 0;                 // outside the camera frustum.
+    int shadowCulledInstances = 0;           // outside the light frustum.
+    int occludedInstances = 0;               // behind the previous frame's depth.
+    int meshlets = 0;                        // of the color pass.
+    int culledMeshlets = 0;
+    // When the input shown by the frame was sampled, set by FrameRing.
+    std::chrono::steady_clock::time_point inputTime{};
+};
+
 /**
  * Contains all buffers relevant to the rendering pipeline.
  * Used also in order to avoid memory allocation for each frame,
  * hence the reset function.
+ * Clearing is lazy - reset only invalidates the tiles, see TileClearState.
+ * The buffers are allocated uninitialized, so each tile's pages are first
+ * touched by the worker that renders (or resolves) it.
  */
 struct RenderBuffers {
-    std::vector<unsigned char> colorBuffer;
+    // One packed 32-bit pixel per entry, channel order given by colorFormat.
+    AlignedVector<std::uint32_t> colorBuffer;
 
-    std::vector<float> zbuffer;
-    std::vector<Vec3f> normalBuffer;
-    std::vector<float> shadowMap;
+    AlignedVector<float> zbuffer;
+    AlignedVector<Vec3f> normalBuffer;
+    AlignedVector<float> shadowMap;
 
     int width, height;
     int shadowW, shadowH;
 
+    TileClearState colorTiles;
+    TileClearState shadowTiles;
+
+    PixelFormat colorFormat;
+
+    // Built from zbuffer at the end of each frame, the occluders of the next one.
+    DepthPyramid depthPyramid;
+
+    // Working memory of the geometry passes, reused by every frame rendered into these buffers.
+    GeometryScratch shadowScratch;
+    GeometryScratch colorScratch;
+
+    RenderStats stats;
+
     RenderBuffers(const RenderBuffers&) = delete;
     RenderBuffers& operator=(const RenderBuffers&) = delete;
     RenderBuffers(RenderBuffers&&) = delete;
     RenderBuffers& operator=(RenderBuffers&&) = delete;
 
-    RenderBuffers(const int w,  const int h, const int sw, const int sh)
-        : colorBuffer(w * h * 3, 0),
-          zbuffer(w * h, -std::numeric_limits<float>::max()),
-          normalBuffer(w * h, Vec3f(0, 0, 0)),
-          shadowMap(sw * sh, -std::numeric_limits<float>::max()),
-          width(w), height(h), shadowW(sw), shadowH(sh)
+    RenderBuffers(const int w,  const int h, const int sw, const int sh,
+                  const PixelFormat format = PixelFormat::RGBA8)
+        : colorBuffer(w * h),
+          zbuffer(w * h),
+          normalBuffer(w * h),
+          shadowMap(sw * sh),
+          width(w), height(h), shadowW(sw), shadowH(sh),
+          colorTiles(w, h), shadowTiles(sw, sh),
+          colorFormat(format)
     {}
 
     void reset()
     {
-        std::ranges::fill(colorBuffer.begin(), colorBuffer.end(), 0);
-        std::ranges::fill(zbuffer, -std::numeric_limits<float>::max());
-        std::ranges::fill(normalBuffer, Vec3f(0, 0, 0));
-        std::ranges::fill(shadowMap, -std::numeric_limits<float>::max());
+        colorTiles.invalidate();
+        shadowTiles.invalidate();
+    }
+
+    /**
+     * Changes the render resolution, the shadow map is not affected.
+     * Shrinking keeps the allocation, so scaling back up to a previous
+     * size does not allocate. All the tiles start stale.
+     */
+    void resize(const int w, const int h)
+    {
+        if (w == width && h == height) return;
+
+        colorBuffer.resize(w * h);
+        zbuffer.resize(w * h);
+        normalBuffer.resize(w * h);
+        width = w;
+        height = h;
+        colorTiles = TileClearState(w, h);
     }
 };
 
+/**
+ * Geometry of a frame - the shaders and binned triangles of the shadow and
+ * color passes, plus the scene settings the raster passes need.
+ * Built by Renderer::prepare and consumed by Renderer::rasterize, it holds
+ * everything taken from the scene, so the scene may change in between.
+ * Shaders must outlive the passes, reserve keeps the DrawCall pointers stable.
+ * prepare rebuilds it from scratch every time, so a frame may be reused but
+ * nothing of its previous contents carries over.
+ */
+struct PreparedFrame {
+    Matrix4f4 lightProjView;
+    Matrix4f4 viewProj;
+    Vec3f cameraPos;
+    Vec3f cameraDir;
+    std::vector<DepthShader> depthShaders;
+    std::vector<PhongShader> phongShaders;
+    BinnedGeometry shadowGeometry;
+    BinnedGeometry colorGeometry;
+    bool useShadows = true;
+    bool useSSAO = true;
+    bool useOcclusionCulling = true;
+    // Depth of an earlier frame to cull against, null if unusable.
+    const DepthPyramid* occluders = nullptr;
+    int instances = 0;
+    int culledInstances = 0;
+    int shadowCulledInstances = 0;
+    int occludedInstances = 0;
+};
+
+class FrameGraph;
+
 class Renderer {
 public:
     /**
      * @brief Renders the scene using the given buffers from target.
-     *        The logic is - shadow pass -> color pass -> SSAO
+     *        The logic is - shadow pass -> color pass -> SSAO, run as a frame graph
+     *        so the color pass vertex processing overlaps the shadow raster.
      * @param scene - Contains the model, camera and lighting relevant for the scene.
      * @param target - Contains the z-buffer, framebuffer, normal map and shadow map.
+     *                 The frame's render time is written to target.stats.
+     * @param occluders - Depth pyramid of the previous frame, see occlusion culling
+     *                    below. Must not be target.depthPyramid, which is rebuilt.
+     */
+    static void render(const Scene& scene, RenderBuffers& target, const DepthPyramid* occluders = nullptr);
+
+    /**
+     * @brief First half of render - vertex processing and binning of the frame.
+     *        Does not touch the target buffers, so it can run while the
+     *        previous frame is still rasterizing (see FrameRing pipelining).
+     * @param scene - The scene, not referenced once the function returns.
+     * @param target - Only its size and geometry scratch are used, and stats.geometryMs is written.
+     * @param frame - Reset, then filled with the frame's geometry.
+     * @param occluders - As in render, must stay alive until rasterize returns.
      */
-    static void render(const Scene& scene, RenderBuffers& target);
+    static void prepare(const Scene& scene, RenderBuffers& target, PreparedFrame& frame,
+                        const DepthPyramid* occluders = nullptr);
+
+    /**
+     * @brief Second half of render - shadow raster, color raster and SSAO.
+     * @param frame - Output of prepare for the same target.
+     * @param target - Rendered into, stats.rasterMs and stats.renderMs are written.
+     */
+    static void rasterize(const PreparedFrame& frame, RenderBuffers& target);
 
 private:
+    static void addGeometryPasses(FrameGraph& graph, const Scene& scene,
+                                  RenderBuffers& target, PreparedFrame& frame);
+    static void addRasterPasses(FrameGraph& graph, const PreparedFrame& frame, RenderBuffers& target);
+
+    /**
+     * Occlusion culling tests the color pass instances and meshlets against the
+     * previous frame's depth pyramid, reprojected with that frame's view projection.
+     * After a camera jump the old depth no longer matches the view, so it is not used.
+     * Shadow casters are never occlusion culled - they may be hidden from the camera
+     * and still cast visible shadows.
+     */
+    static const DepthPyramid* usableOccluders(const DepthPyramid* occluders, const PreparedFrame& frame);
+
     /**
      * The function checks which pixels are hidden.
      * 'Hidden pixels' are pixels hidden from the light source - assuming a single light source.
-     * The result is saved using the shadow map buffer and then used during
-     * color pass.
-     * This function does not affect the framebuffer.
+     * Builds the geometry of the shadow pass (light space triangles binned into tiles),
+     * rasterizing it fills the shadow map which is then used during color pass.
+     * This function does not touch any buffer, only target.shadowScratch.
      * */
-    static void runShadowPass(const Scene& scene,
-                              RenderBuffers &target,
-                              const Matrix4f4& lightProjView);
+    static void buildShadowGeometry(const Scene& scene,
+                                    RenderBuffers& target,
+                                    PreparedFrame& frame);
 
-    /** For each pixel, draws the correct color based on lighting, shadow, model texture file,
-       and occlusions. */
-    static void runColorPass(const Scene& scene,
-                             RenderBuffers& target,
-                             const Matrix4f4& lightProjView);
+    /** Builds the geometry of the color pass. Rasterizing it draws for each pixel
+       the correct color based on lighting, shadow, model texture file, and occlusions. */
+    static void buildColorGeometry(const Scene& scene,
+                                   RenderBuffers& target,
+                                   PreparedFrame& frame);
 
     // Adds the SSAO effect to the scene.
     static void applySSAO(RenderBuffers& target);
@@ -83,7 +208,7 @@ private:
 
     static float computePixelOcclusion(int x, int y,
                                        int width, int height,
-                                       const std::vector<float>& zbuffer,
+                                       const AlignedVector<float>& zbuffer,
                                        const std::vector<Vec2f>& kernel,
                                        const std::vector<Vec2f>& noise);
 
@@ -94,11 +219,14 @@ private:
     static constexpr float SSAO_BACKGROUND_THRESHOLD = 100.0f;
     static constexpr float SSAO_MAX_OCCLUSION_DISTANCE = 2.0f;
     static constexpr float LIGHT_PROJECTION_SIZE = 3.0f;
+    static constexpr float OCCLUSION_MAX_CAMERA_MOVE = 0.5f;
+    static constexpr float OCCLUSION_MAX_CAMERA_TURN_COS = 0.985f;
 
     static constexpr float SSAO_SAMPLE_RADIUS = 25.0f;
     static constexpr float SSAO_BIAS = 0.05f;
     static constexpr float SSAO_STRENGTH = 0.3f;
     static constexpr int SSAO_RANDOM_PIXEL_SAMPLES = 16;
+    static constexpr int SSAO_ROW_GRAIN = 8;
 };
 
 
@@ -0,0 +1,32 @@
+#include "ResolutionScaler.h"
+#include "../Core/Rasterizer.h"
+#include <algorithm>
+#include <cmath>
+
+float ResolutionScaler::update(const float renderMs)
+{
+    averageMs = averageMs == 0.0f ? renderMs
+                                  : averageMs + settings.smoothing * (renderMs - averageMs);
+
+    if (!enabled) {
+        currentScale = settings.maxScale;
+        return currentScale;
+    }
+
+    // Stay put while the average is within the budget band, avoids oscillating.
+    const float budgetError = averageMs / settings.targetFrameMs - 1.0f;
+    if (std::abs(budgetError) < settings.hysteresis) return currentScale;
+
+    // Cost is proportional to the pixel count, i.e. to scale^2.
+    float factor = std::sqrt(settings.targetFrameMs / std::max(averageMs, 0.01f));
+    factor = std::clamp(factor, 1.0f - settings.maxStep, 1.0f + settings.maxStep);
+
+    currentScale = std::clamp(currentScale * factor, settings.minScale, settings.maxScale);
+    return currentScale;
+}
+
+int ResolutionScaler::scaledSize(const int displaySize) const
+{
+    const int size = static_cast<int>(std::lround(static_cast<float>(displaySize) * currentScale));
+    return std::clamp(size, std::min(TILE_SIZE, displaySize), displaySize);
+}
@@ -0,0 +1,49 @@
+#ifndef RENDERER_RESOLUTIONSCALER_H
+#define RENDERER_RESOLUTIONSCALER_H
+
+
+/**
+ * Picks the internal render resolution from the measured frame time.
+ * Under heavy scenes the resolution drops to hold the frame budget
+ * instead of the frame rate, and it climbs back when there is headroom.
+ * The scale applies to both axes, so the render cost is roughly scale^2.
+ */
+class ResolutionScaler {
+public:
+    struct Settings {
+        float targetFrameMs = 16.6f;
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        float maxStep = 0.1f;           // largest relative change per update.
+        float hysteresis = 0.1f;        // tolerated budget error before rescaling.
+        float smoothing = 0.2f;         // weight of the newest sample in the average.
+    };
+
+    ResolutionScaler() = default;
+    explicit ResolutionScaler(const Settings& settings) : settings(settings), currentScale(settings.maxScale) {}
+
+    /**
+     * @brief Feeds the render time of a finished frame.
+     *
+     * @param renderMs      time the frame took in Renderer::render.
+     * @return                          the scale for the next frames.
+     */
+    float update(float renderMs);
+
+    /**
+     * @brief Returns the render size for a display size, never below one tile.
+     */
+    [[nodiscard]] int scaledSize(int displaySize) const;
+
+    [[nodiscard]] float scale() const { return currentScale; }
+    [[nodiscard]] float averageFrameMs() const { return averageMs; }
+
+    Settings settings;
+    bool enabled = true;
+
+private:
+    float currentScale = 1.0f;
+    float averageMs = 0.0f;
+};
+
+#endif //RENDERER_RESOLUTIONSCALER_H
@@ -1,11 +1,19 @@
 #ifndef RENDERER_SCENE_H
 #define RENDERER_SCENE_H
 
+#include <functional>
 #include <vector>
 #include "../Core/Camera.h"
 #include "../Core/ModelInstance.h"
+#include "SceneBVH.h"
 
 
+// Nearest model face hit by a ray, see Scene::raycast.
+struct RayHit {
+    int instance = -1;          // index into Scene::models, -1 on a miss.
+    TriangleBVH::Hit face;
+};
+
 struct Scene {
     std::vector<ModelInstance> models;
 
@@ -18,17 +26,52 @@ struct Scene {
 
     bool useShadows = true;
     bool useSSAO = true;
+    bool useOcclusionCulling = true;
+
+    // Bounds of models, refit by updateBounds. The renderer culls with it
+    // when it matches the models, and falls back to testing each model.
+    SceneBVH bvh;
 
     Scene(const Camera& cam, const Vec3f& lightDir, const Vec3f& lightPos)
         : cameras(), lightDir(lightDir), lightPos(lightPos) {
         cameras.push_back(cam);
     }
 
-    void addModel(ModelInstance& model) {
-        model.updateBBox();
+    // The resource's bounding box is computed once when it is loaded, the
+    // resource is shared with published snapshots and must not change here.
+    void addModel(const ModelInstance& model) {
         models.push_back(model);
     }
 
+    // Call after editing models, before rendering or picking.
+    void updateBounds() {
+        for (auto& model : models) model.updateTransform();
+        bvh.sync(models);
+    }
+
+    /**
+     * Nearest model face hit by the ray. The BVH orders the instances and skips
+     * the ones whose box is farther than the best hit so far, the faces decide.
+     * Call updateBounds first. Instances rejected by accept are ignored.
+     */
+    [[nodiscard]] RayHit raycast(const Vec3f& origin, const Vec3f& dir,
+                                 const std::function<bool(int)>& accept = nullptr) const {
+        RayHit result;
+        float t;
+        bvh.raycast(origin, dir, t, [&](const int i, const float tMax) {
+            if (accept && !accept(i)) return -1.0f;
+
+            TriangleBVH::Hit hit;
+            hit.t = tMax;
+            if (!models[i].raycast(origin, dir, hit)) return -1.0f;
+
+            result.instance = i;
+            result.face = hit;
+            return hit.t;
+        });
+        return result;
+    }
+
     Camera& getActiveCamera() { return cameras[activeCameraIndex]; }
     const Camera& getActiveCamera() const { return cameras[activeCameraIndex]; }
 };
@@ -0,0 +1,309 @@
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    void expand(AABB& box, const AABB& other)
+    {
+        for (int i = 0; i < 3; ++i) {
+            box.min[i] = std::min(box.min[i], other.min[i]);
+            box.max[i] = std::max(box.max[i], other.max[i]);
+        }
+    }
+
+    float surfaceArea(const AABB& box)
+    {
+        const Vec3f extent = box.max - box.min;
+        if (extent.x() < 0.0f || extent.y() < 0.0f || extent.z() < 0.0f) return 0.0f;
+        return 2.0f * (extent.x() * extent.y() + extent.y() * extent.z() + extent.z() * extent.x());
+    }
+
+    bool overlaps(const AABB& a, const AABB& b)
+    {
+        for (int i = 0; i < 3; ++i) {
+            if (a.max[i] < b.min[i] || b.max[i] < a.min[i]) return false;
+        }
+        return true;
+    }
+
+    // Slab test, unlike RayBoxInterSection a ray starting inside the box hits it at 0.
+    float rayEntry(const Vec3f& origin, const Vec3f& invDir, const AABB& box)
+    {
+        float tNear = 0.0f;
+        float tFar = std::numeric_limits<float>::max();
+        for (int i = 0; i < 3; ++i) {
+            const float t1 = (box.min[i] - origin[i]) * invDir[i];
+            const float t2 = (box.max[i] - origin[i]) * invDir[i];
+            tNear = std::max(tNear, std::min(t1, t2));
+            tFar = std::min(tFar, std::max(t1, t2));
+            if (tNear > tFar) return -1.0f;
+        }
+        return tNear;
+    }
+}
+
+bool SceneBVH::InstanceKey::operator==(const InstanceKey& other) const
+{
+    for (int i = 0; i < 3; ++i) {
+        if (position[i] != other.position[i] || rotation[i] != other.rotation[i] ||
+            scale[i] != other.scale[i]) return false;
+    }
+    return resource == other.resource;
+}
+
+void SceneBVH::sync(const std::vector<ModelInstance>& models)
+{
+    auto worldBounds = [](const ModelInstance& model) {
+        return model.resource ? model.getWorldAABB() : AABB();
+    };
+    auto keyOf = [](const ModelInstance& model) {
+        return InstanceKey{ model.resource.get(), model.position, model.rotation, model.scale };
+    };
+
+    if (models.size() != keys.size() || models.size() != instanceBounds.size()) {
+        std::vector<AABB> bounds;
+        bounds.reserve(models.size());
+        keys.clear();
+        for (const auto& model : models) {
+            bounds.push_back(worldBounds(model));
+            keys.push_back(keyOf(model));
+        }
+        build(std::move(bounds));
+        return;
+    }
+
+    for (int i = 0; i < static_cast<int>(models.size()); ++i) {
+        const InstanceKey key = keyOf(models[i]);
+        if (key == keys[i]) continue;
+
+        keys[i] = key;
+        update(i, worldBounds(models[i]));
+    }
+    refit();
+}
+
+void SceneBVH::build(std::vector<AABB> bounds)
+{
+    instanceBounds = std::move(bounds);
+    const int count = static_cast<int>(instanceBounds.size());
+
+    order.resize(count);
+    std::iota(order.begin(), order.end(), 0);
+    leafOf.assign(count, -1);
+    nodes.clear();
+    dirtyLeaves.clear();
+
+    if (count > 0) {
+        nodes.reserve(2 * (count / LEAF_SIZE + 1));
+        nodes.emplace_back();
+        buildNode(0, 0, count);
+    }
+
+    dirtyNodes.assign(nodes.size(), 0);
+    buildCost = treeCost();
+}
+
+void SceneBVH::buildNode(const int index, const int begin, const int end)
+{
+    AABB box;
+    AABB centroids;
+    for (int i = begin; i < end; ++i) {
+        const AABB& instance = instanceBounds[order[i]];
+        expand(box, instance);
+
+        AABB center;
+        center.min = center.max = (instance.min + instance.max) * 0.5f;
+        expand(centroids, center);
+    }
+    nodes[index].bounds = box;
+
+    if (end - begin <= LEAF_SIZE) {
+        nodes[index].first = begin;
+        nodes[index].count = end - begin;
+        for (int i = begin; i < end; ++i) leafOf[order[i]] = index;
+        return;
+    }
+
+    // Median split along the widest axis of the centers.
+    const Vec3f extent = centroids.max - centroids.min;
+    int axis = 0;
+    if (extent.y() > extent[axis]) axis = 1;
+    if (extent.z() > extent[axis]) axis = 2;
+
+    const int mid = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                     [this, axis](const int a, const int b) {
+                         return instanceBounds[a].min[axis] + instanceBounds[a].max[axis] <
+                                instanceBounds[b].min[axis] + instanceBounds[b].max[axis];
+                     });
+
+    // Children are always after their parent, refit relies on it.
+    const int left = static_cast<int>(nodes.size());
+    nodes[index].first = left;
+    nodes[index].count = 0;
+    nodes.emplace_back();
+    nodes.emplace_back();
+    nodes[left].parent = index;
+    nodes[left + 1].parent = index;
+
+    buildNode(left, begin, mid);
+    buildNode(left + 1, mid, end);
+}
+
+void SceneBVH::update(const int instance, const AABB& box)
+{
+    instanceBounds[instance] = box;
+    dirtyLeaves.push_back(leafOf[instance]);
+}
+
+void SceneBVH::refit()
+{
+    if (dirtyLeaves.empty()) return;
+
+    for (int node : dirtyLeaves) {
+        while (node != -1 && !dirtyNodes[node]) {
+            dirtyNodes[node] = 1;
+            node = nodes[node].parent;
+        }
+    }
+    dirtyLeaves.clear();
+
+    for (int i = static_cast<int>(nodes.size()) - 1; i >= 0; --i) {
+        if (!dirtyNodes[i]) continue;
+        dirtyNodes[i] = 0;
+
+        Node& node = nodes[i];
+        AABB box;
+        if (node.count > 0) {
+            for (int k = node.first; k < node.first + node.count; ++k) expand(box, instanceBounds[order[k]]);
+        } else {
+            expand(box, nodes[node.first].bounds);
+            expand(box, nodes[node.first + 1].bounds);
+        }
+        node.bounds = box;
+    }
+
+    // Refitting keeps the topology, which gets poor once instances moved far apart.
+    if (treeCost() > REBUILD_COST_RATIO * buildCost) {
+        build(std::move(instanceBounds));
+    }
+}
+
+float SceneBVH::treeCost() const
+{
+    float cost = 0.0f;
+    for (const auto& node : nodes) cost += surfaceArea(node.bounds);
+    return cost;
+}
+
+template <typename Overlaps>
+void SceneBVH::query(const Overlaps& overlaps, std::vector<int>& out) const
+{
+    out.clear();
+    if (nodes.empty()) return;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (!overlaps(node.bounds)) continue;
+
+        if (node.count > 0) {
+            for (int k = node.first; k < node.first + node.count; ++k) {
+                if (overlaps(instanceBounds[order[k]])) out.push_back(order[k]);
+            }
+        } else {
+            stack[top++] = node.first;
+            stack[top++] = node.first + 1;
+        }
+    }
+
+    // Callers draw in scene order.
+    std::sort(out.begin(), out.end());
+}
+
+void SceneBVH::queryFrustum(const Frustum& frustum, std::vector<int>& out) const
+{
+    query([&frustum](const AABB& box) {
+        const Vec3f center = (box.min + box.max) * 0.5f;
+        const float radius = (box.max - box.min).length() * 0.5f;
+        return frustum.intersectsSphere(center, radius) && frustum.intersectsAABB(box.min, box.max);
+    }, out);
+}
+
+void SceneBVH::queryAABB(const AABB& box, std::vector<int>& out) const
+{
+    query([&box](const AABB& other) { return overlaps(box, other); }, out);
+}
+
+template <typename Intersect>
+int SceneBVH::traverseRay(const Vec3f& origin, const Vec3f& dir, float& tHit, const Intersect& intersect) const
+{
+    tHit = std::numeric_limits<float>::max();
+    if (nodes.empty()) return -1;
+
+    const Vec3f invDir(1.0f / dir.x(), 1.0f / dir.y(), 1.0f / dir.z());
+    int closest = -1;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        const float entry = rayEntry(origin, invDir, node.bounds);
+        if (entry < 0.0f || entry >= tHit) continue;
+
+        if (node.count > 0) {
+            for (int k = node.first; k < node.first + node.count; ++k) {
+                const int instance = order[k];
+                const float t = intersect(instance, tHit);
+                if (t < 0.0f || t >= tHit) continue;
+
+                tHit = t;
+                closest = instance;
+            }
+            continue;
+        }
+
+        // Visit the nearer child first, so the farther one is often skipped.
+        const int a = node.first;
+        const int b = node.first + 1;
+        const float entryA = rayEntry(origin, invDir, nodes[a].bounds);
+        const float entryB = rayEntry(origin, invDir, nodes[b].bounds);
+        if (entryA <= entryB) {
+            stack[top++] = b;
+            stack[top++] = a;
+        } else {
+            stack[top++] = a;
+            stack[top++] = b;
+        }
+    }
+
+    return closest;
+}
+
+int SceneBVH::raycast(const Vec3f& origin, const Vec3f& dir, float& tHit,
+                      const std::function<bool(int)>& accept) const
+{
+    return traverseRay(origin, dir, tHit, [&](const int instance, const float) {
+        if (accept && !accept(instance)) return -1.0f;
+        const AABB& box = instanceBounds[instance];
+        return ModelInstance::RayBoxInterSection(origin, dir, box.min, box.max);
+    });
+}
+
+int SceneBVH::raycast(const Vec3f& origin, const Vec3f& dir, float& tHit,
+                      const std::function<float(int, float)>& intersect) const
+{
+    // The instance's own box first, intersect is usually far more expensive.
+    const Vec3f invDir(1.0f / dir.x(), 1.0f / dir.y(), 1.0f / dir.z());
+    return traverseRay(origin, dir, tHit, [&](const int instance, const float tMax) {
+        const float entry = rayEntry(origin, invDir, instanceBounds[instance]);
+        if (entry < 0.0f || entry >= tMax) return -1.0f;
+        return intersect(instance, tMax);
+    });
+}
@@ -0,0 +1,120 @@
+#ifndef RENDERER_SCENEBVH_H
+#define RENDERER_SCENEBVH_H
+
+#include "../Core/ModelInstance.h"
+#include "../Math/Frustum.h"
+#include <functional>
+#include <vector>
+
+/**
+ * Bounding volume hierarchy over the world boxes of Scene::models.
+ * Used for frustum culling, ray picking and range queries.
+ *
+ * Moving instances only refits the boxes on their path to the root, the tree
+ * is rebuilt when instances are added or removed, or when refitting has made
+ * it too loose (see REBUILD_COST_RATIO).
+ * Queries are const and may run from any number of threads.
+ */
+class SceneBVH {
+public:
+    /**
+     * @brief Brings the tree up to date with the models. Instances whose
+     *        transform or resource changed since the last call are refit.
+     * @param models - The scene's models, indexed the same way by the queries.
+     */
+    void sync(const std::vector<ModelInstance>& models);
+
+    /**
+     * @brief Builds the tree from scratch.
+     * @param bounds - World box of each instance.
+     */
+    void build(std::vector<AABB> bounds);
+
+    // Changes the box of one instance, applied on the next refit.
+    void update(int instance, const AABB& box);
+
+    // Refits the nodes above the updated instances, rebuilds if the tree got too loose.
+    void refit();
+
+    /**
+     * @brief Collects the instances whose box intersects the frustum.
+     * @param frustum - Culling volume, in world space.
+     * @param out - Cleared, then filled with the instance indices in ascending order.
+     */
+    void queryFrustum(const Frustum& frustum, std::vector<int>& out) const;
+
+    /**
+     * @brief Collects the instances whose box overlaps the given box.
+     * @param box - Query range, in world space.
+     * @param out - Cleared, then filled with the instance indices in ascending order.
+     */
+    void queryAABB(const AABB& box, std::vector<int>& out) const;
+
+    /**
+     * @brief Finds the nearest instance box hit by the ray.
+     * @param origin - Ray origin.
+     * @param dir - Ray direction, need not be normalized.
+     * @param tHit - Set to the hit distance along dir.
+     * @param accept - Optional filter, instances it rejects are ignored.
+     * @return The instance index, or -1 if nothing was hit.
+     */
+    int raycast(const Vec3f& origin, const Vec3f& dir, float& tHit,
+                const std::function<bool(int)>& accept = nullptr) const;
+
+    /**
+     * @brief Finds the nearest instance hit by the ray as reported by intersect,
+     *        e.g. against its faces. Boxes only order and skip the instances.
+     * @param intersect - Given an instance and the best distance so far, returns
+     *                    a closer hit distance, or a negative value if there is none.
+     */
+    int raycast(const Vec3f& origin, const Vec3f& dir, float& tHit,
+                const std::function<float(int, float)>& intersect) const;
+
+    [[nodiscard]] const AABB& bounds(const int instance) const { return instanceBounds[instance]; }
+    [[nodiscard]] size_t size() const { return instanceBounds.size(); }
+    [[nodiscard]] size_t nodeCount() const { return nodes.size(); }
+
+private:
+    // Leaves have count > 0 and hold order[first, first + count),
+    // inner nodes have count == 0 and their children at first and first + 1.
+    struct Node {
+        AABB bounds;
+        int first = 0;
+        int count = 0;
+        int parent = -1;
+    };
+
+    // What an instance's world box depends on, to detect moved instances.
+    struct InstanceKey {
+        const ModelResource* resource = nullptr;
+        Vec3f position;
+        Vec3f rotation;
+        Vec3f scale;
+
+        bool operator==(const InstanceKey& other) const;
+    };
+
+    void buildNode(int index, int begin, int end);
+    float treeCost() const;
+
+    template <typename Overlaps>
+    void query(const Overlaps& overlaps, std::vector<int>& out) const;
+
+    // Nearest-first traversal, intersect(instance, tHit) as in the public overload.
+    template <typename Intersect>
+    int traverseRay(const Vec3f& origin, const Vec3f& dir, float& tHit, const Intersect& intersect) const;
+
+    std::vector<Node> nodes;
+    std::vector<int> order;                  // instance indices grouped by leaf.
+    std::vector<int> leafOf;                 // leaf node of each instance.
+    std::vector<AABB> instanceBounds;
+    std::vector<InstanceKey> keys;
+    std::vector<int> dirtyLeaves;
+    std::vector<char> dirtyNodes;
+    float buildCost = 0.0f;
+
+    static constexpr int LEAF_SIZE = 4;
+    static constexpr float REBUILD_COST_RATIO = 2.0f;
+};
+
+#endif //RENDERER_SCENEBVH_H
@@ -0,0 +1,38 @@
+#include "SceneSnapshots.h"
+#include <atomic>
+
+void SceneSnapshots::publish(const Scene& scene)
+{
+    std::shared_ptr<Scene> storage;
+    for (const auto& entry : pool) {
+        if (entry.use_count() == 1) {
+            // Pairs with the release of the last reader's reference.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            storage = entry;
+            break;
+        }
+    }
+
+    if (storage) {
+        *storage = scene;
+    } else {
+        storage = std::make_shared<Scene>(scene);
+        pool.push_back(storage);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    current = std::move(storage);
+    publishedVersion++;
+}
+
+SceneSnapshot SceneSnapshots::latest() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return current;
+}
+
+std::uint64_t SceneSnapshots::version() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return publishedVersion;
+}
@@ -0,0 +1,49 @@
+#ifndef RENDERER_SCENESNAPSHOTS_H
+#define RENDERER_SCENESNAPSHOTS_H
+
+#include "Scene.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using SceneSnapshot = std::shared_ptr<const Scene>;
+
+/**
+ * Double-buffered hand-off of the scene from the UI thread to the renderer.
+ * The UI thread owns and edits the front Scene and publishes a copy of it
+ * once per frame. Readers take the latest snapshot, which is immutable and
+ * stays alive (and consistent) for as long as they hold it, independent
+ * of any later edit or publish.
+ *
+ * Snapshot storage is recycled once no reader holds it, so in steady state
+ * publishing is a copy of the instances into existing storage, with no allocation.
+ */
+class SceneSnapshots {
+public:
+    /**
+     * @brief Publishes a copy of the scene. Must be called from a single thread.
+     *
+     * @param scene                          the front (UI owned) scene.
+     */
+    void publish(const Scene& scene);
+
+    /**
+     * @brief Any thread.
+     * @return The most recently published snapshot, nullptr before the first publish.
+     */
+    [[nodiscard]] SceneSnapshot latest() const;
+
+    // Number of publishes so far, the version of latest().
+    [[nodiscard]] std::uint64_t version() const;
+
+private:
+    // Storage owned by the publisher, a snapshot is reusable once only the pool references it.
+    std::vector<std::shared_ptr<Scene>> pool;
+
+    mutable std::mutex mutex;
+    SceneSnapshot current;
+    std::uint64_t publishedVersion = 0;
+};
+
+#endif //RENDERER_SCENESNAPSHOTS_H
@@ -20,6 +20,13 @@ public:
                     const Vec3f& tangent,
                     const Vec3f& bitangent) override;
 
+    Varyings vertex(const Vec4f& clip,
+                    const Vec3f& localPos,
+                    const Vec3f& normal,
+                    const Vec2f& uv,
+                    const Vec3f& tangent,
+                    const Vec3f& bitangent) override;
+
 
     /**
      * Returns no color, this shader used to determine the shadowMap
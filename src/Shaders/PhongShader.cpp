@@ -23,15 +23,19 @@ Varyings PhongShader::vertex(const Vec3f &localPos,
                              const Vec3f &tangent,
                              const Vec3f &bitangent)
 {
-    Varyings out;
-
-    Vec4f clip = uniforms.projection * uniforms.modelView * Vec4f(localPos);
-    out.invW = 1.0f / clip.w();
+    return vertex(uniforms.projection * uniforms.modelView * Vec4f(localPos), localPos, normal, uv, tangent, bitangent);
+}
 
-    const Vec4f ndc = clip * out.invW;
-    const Vec4f screen = uniforms.viewport * ndc;
+Varyings PhongShader::vertex(const Vec4f &clip,
+                             const Vec3f &localPos,
+                             const Vec3f &normal,
+                             const Vec2f &uv,
+                             const Vec3f &tangent,
+                             const Vec3f &bitangent)
+{
+    Varyings out;
 
-    out.screenPos = Vec3f(screen.x(), screen.y(), screen.z());
+    out.screenPos = toScreen(uniforms.viewport, clip, out.invW);
 
     out.uv = uv * out.invW;
     Vec4f world = uniforms.model * Vec4f(localPos);
@@ -0,0 +1,104 @@
+#ifndef RENDERER_ALIGNEDALLOCATOR_H
+#define RENDERER_ALIGNEDALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace AlignedMemory {
+    constexpr std::size_t CACHE_LINE_SIZE = 64;
+    constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    /**
+     * Opt-in transparent huge pages for allocations of at least one huge page.
+     * Defaults to the RENDERER_HUGE_PAGES environment variable, only has an
+     * effect on Linux (madvise), elsewhere the allocation is just aligned.
+     */
+    inline std::atomic<bool> useHugePages{ std::getenv("RENDERER_HUGE_PAGES") != nullptr };
+
+    inline void* allocate(std::size_t bytes, std::size_t alignment)
+    {
+        const bool huge = useHugePages.load(std::memory_order_relaxed) && bytes >= HUGE_PAGE_SIZE;
+        if (huge) alignment = HUGE_PAGE_SIZE;
+
+        // aligned_alloc requires the size to be a multiple of the alignment.
+        bytes = (bytes + alignment - 1) / alignment * alignment;
+        void* ptr = std::aligned_alloc(alignment, bytes);
+        if (!ptr) throw std::bad_alloc();
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (huge) madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+        return ptr;
+    }
+
+    inline void deallocate(void* ptr)
+    {
+        std::free(ptr);
+    }
+}
+
+/**
+ * Allocator for render and texture buffers.
+ * Storage is aligned to a cache line (so SIMD stores never split one) and
+ * optionally backed by huge pages, see AlignedMemory::useHugePages.
+ *
+ * Default construction leaves trivial element types uninitialized, so the
+ * pages are first touched by whoever initializes them - for the render
+ * targets that is the tile worker clearing the tile, see TileClearState.
+ */
+template <typename T, std::size_t Alignment = AlignedMemory::CACHE_LINE_SIZE>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    [[nodiscard]] T* allocate(const std::size_t n)
+    {
+        return static_cast<T*>(AlignedMemory::allocate(n * sizeof(T), Alignment));
+    }
+
+    void deallocate(T* ptr, std::size_t) noexcept
+    {
+        AlignedMemory::deallocate(ptr);
+    }
+
+    template <typename U>
+    void construct(U* ptr) noexcept(std::is_nothrow_default_constructible_v<U>)
+    {
+        // Implicit-lifetime types need no constructor call, skip touching the memory.
+        if constexpr (!(std::is_trivially_copyable_v<U> && std::is_trivially_destructible_v<U>)) {
+            ::new (static_cast<void*>(ptr)) U;
+        }
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* ptr, Args&&... args)
+    {
+        ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+#endif //RENDERER_ALIGNEDALLOCATOR_H
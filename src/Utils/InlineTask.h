@@ -0,0 +1,86 @@
+#ifndef RENDERER_INLINETASK_H
+#define RENDERER_INLINETASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+/**
+ * Type erased void() callable stored inline, a std::function replacement
+ * that never allocates. Captures must fit in CAPACITY bytes, which is
+ * checked at compile time - capture by reference or pack bigger state
+ * in a struct owned by the caller.
+ */
+class InlineTask {
+public:
+    static constexpr std::size_t CAPACITY = 64;
+
+    InlineTask() = default;
+
+    template <typename F, typename Fn = std::decay_t<F>>
+    requires (!std::is_same_v<Fn, InlineTask>) && std::is_invocable_v<Fn&>
+    InlineTask(F&& f)
+    {
+        static_assert(sizeof(Fn) <= CAPACITY, "Task captures too large for InlineTask storage.");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "Task captures over-aligned.");
+        static_assert(std::is_nothrow_move_constructible_v<Fn>, "Task must be nothrow movable.");
+
+        ::new (static_cast<void*>(storage)) Fn(std::forward<F>(f));
+        invokeFn = [](void* self) { (*static_cast<Fn*>(self))(); };
+        manageFn = [](void* dst, void* src) noexcept {
+            if (src) ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src ? src : dst)->~Fn();
+        };
+    }
+
+    InlineTask(InlineTask&& other) noexcept { moveFrom(other); }
+
+    InlineTask& operator=(InlineTask&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    InlineTask(const InlineTask&) = delete;
+    InlineTask& operator=(const InlineTask&) = delete;
+
+    ~InlineTask() { reset(); }
+
+    void operator()() { invokeFn(storage); }
+
+    explicit operator bool() const { return invokeFn != nullptr; }
+
+    void reset() noexcept
+    {
+        if (manageFn) manageFn(storage, nullptr);
+        invokeFn = nullptr;
+        manageFn = nullptr;
+    }
+
+private:
+    // manageFn(dst, src) move-constructs src into dst and destroys src,
+    // manageFn(self, nullptr) destroys self.
+    using InvokeFn = void (*)(void*);
+    using ManageFn = void (*)(void*, void*) noexcept;
+
+    void moveFrom(InlineTask& other) noexcept
+    {
+        if (!other.invokeFn) return;
+        other.manageFn(storage, other.storage);
+        invokeFn = other.invokeFn;
+        manageFn = other.manageFn;
+        other.invokeFn = nullptr;
+        other.manageFn = nullptr;
+    }
+
+    alignas(std::max_align_t) unsigned char storage[CAPACITY];
+    InvokeFn invokeFn = nullptr;
+    ManageFn manageFn = nullptr;
+};
+
+#endif //RENDERER_INLINETASK_H
@@ -0,0 +1,107 @@
+#ifndef RENDERER_TASKGROUP_H
+#define RENDERER_TASKGROUP_H
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+
+/**
+ * A set of tasks that can be waited on independently of the rest of the pool
+ * (ThreadPool::waitFinished waits for everything). The waiting thread runs
+ * queued tasks while the group is busy, so groups may be nested inside pool
+ * tasks without deadlocking.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool = ThreadPool::instance()) : pool(pool) {}
+    ~TaskGroup() { wait(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    template <typename F>
+    void run(F&& task)
+    {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        pool.enqueue([this, task = std::forward<F>(task)]() mutable {
+            task();
+            finishOne();
+        });
+    }
+
+    // Returns once every task passed to run() has finished.
+    void wait()
+    {
+        while (pending.load(std::memory_order_acquire) > 0) {
+            if (!pool.runPendingTask()) break;
+        }
+
+        // Nothing left to help with, the remaining tasks are running elsewhere.
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+    }
+
+private:
+    void finishOne()
+    {
+        // Decrement under the lock: once wait() observes zero it may destroy the group.
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            finished.notify_all();
+        }
+    }
+
+    ThreadPool& pool;
+    std::atomic<int> pending = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
+/**
+ * @brief Splits [begin, end) into chunks of 'grain' indices and runs
+ *        fn(chunkBegin, chunkEnd) for each, in parallel. Chunks are handed out
+ *        dynamically and the calling thread processes chunks too.
+ *        Safe to call from inside a pool task.
+ *
+ * @param begin                               first index of the range.
+ * @param end                            one past the last index of the range.
+ * @param grain                   number of indices processed per chunk.
+ * @param fn              callable taking (int chunkBegin, int chunkEnd).
+ */
+template <typename F>
+void parallelFor(const int begin, const int end, const int grain, F&& fn,
+                 ThreadPool& pool = ThreadPool::instance())
+{
+    if (begin >= end) return;
+
+    const int chunkSize = std::max(grain, 1);
+    const int chunks = (end - begin + chunkSize - 1) / chunkSize;
+    if (chunks == 1) {
+        fn(begin, end);
+        return;
+    }
+
+    std::atomic<int> nextChunk{0};
+    auto drain = [&] {
+        int chunk;
+        while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunks) {
+            const int chunkBegin = begin + chunk * chunkSize;
+            fn(chunkBegin, std::min(chunkBegin + chunkSize, end));
+        }
+    };
+
+    TaskGroup group(pool);
+    const int helpers = std::min(chunks - 1, static_cast<int>(pool.size()));
+    for (int i = 0; i < helpers; i++) {
+        group.run([&drain] { drain(); });
+    }
+
+    drain();
+    group.wait();
+}
+
+#endif //RENDERER_TASKGROUP_H
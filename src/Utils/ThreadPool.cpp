@@ -1,73 +1,352 @@
 #include "../Utils/ThreadPool.h"
 
-ThreadPool::ThreadPool(const size_t threads) {
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+
+static_assert(ThreadPoolConfig::MAX_CORES == CPU_SETSIZE, "core ids must fit a cpu_set_t");
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Identifies the pool and worker slot of the calling thread, if it is a worker.
+    thread_local ThreadPool* currentPool = nullptr;
+    thread_local size_t currentWorker = 0;
+
+    std::int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    ThreadPoolConfig& sharedConfig()
+    {
+        static ThreadPoolConfig config;
+        return config;
+    }
+
+    std::atomic<bool> sharedCreated = false;
+
+    // Freezes the shared configuration, configure() is ignored from here on.
+    ThreadPoolConfig createSharedConfig()
+    {
+        sharedCreated = true;
+        return ThreadPoolConfig::fromEnvironment(sharedConfig());
+    }
+
+    ThreadPoolConfig withThreads(const size_t threads)
+    {
+        ThreadPoolConfig config;
+        config.threads = threads;
+        return config;
+    }
+
+    std::uint64_t nextRandom(std::uint64_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+}
+
+std::vector<int> ThreadPoolConfig::parseAffinity(const char* text)
+{
+    std::vector<int> cores;
+    if (!text || !*text) return cores;
+
+    if (std::strncmp(text, "0x", 2) == 0 || std::strncmp(text, "0X", 2) == 0) {
+        char* end = nullptr;
+        errno = 0;
+        const unsigned long long mask = std::strtoull(text + 2, &end, 16);
+        if (*end != '\0' || errno == ERANGE) return {};
+        for (int bit = 0; bit < 64; bit++) {
+            if (mask & (1ull << bit)) cores.push_back(bit);
+        }
+        return cores;
+    }
+
+    const char* cursor = text;
+    while (*cursor) {
+        char* end = nullptr;
+        const long first = std::strtol(cursor, &end, 10);
+        if (end == cursor || first < 0) return {};
+        long last = first;
+
+        if (*end == '-') {
+            cursor = end + 1;
+            last = std::strtol(cursor, &end, 10);
+            if (end == cursor || last < first) return {};
+        }
+        if (last >= ThreadPoolConfig::MAX_CORES) return {};
+        for (long core = first; core <= last; core++) cores.push_back(static_cast<int>(core));
+
+        if (*end == ',') end++;
+        else if (*end != '\0') return {};
+        cursor = end;
+    }
+    return cores;
+}
+
+ThreadPoolConfig ThreadPoolConfig::fromEnvironment(ThreadPoolConfig base)
+{
+    if (const char* threads = std::getenv("RENDERER_THREADS")) {
+        const long count = std::strtol(threads, nullptr, 10);
+        if (count > 0) base.threads = static_cast<size_t>(count);
+    }
+    if (const char* affinity = std::getenv("RENDERER_AFFINITY")) {
+        base.affinity = parseAffinity(affinity);
+    }
+    if (const char* spin = std::getenv("RENDERER_SPIN_US")) {
+        const long micros = std::strtol(spin, nullptr, 10);
+        if (micros >= 0) base.spinBeforePark = std::chrono::microseconds(micros);
+    }
+    return base;
+}
+
+ThreadPool& ThreadPool::instance()
+{
+    static ThreadPool pool(createSharedConfig());
+    return pool;
+}
+
+bool ThreadPool::configure(const ThreadPoolConfig& config)
+{
+    if (sharedCreated) return false;
+    sharedConfig() = config;
+    return true;
+}
+
+ThreadPool::ThreadPool(const size_t threads) : ThreadPool(withThreads(threads)) {}
+
+ThreadPool::ThreadPool(const ThreadPoolConfig& config) : settings(config) {
+    if (settings.threads == 0) settings.threads = std::thread::hardware_concurrency();
+    const size_t threads = std::max<size_t>(settings.threads, 1);
+    settings.threads = threads;
+    statsStartNs = nowNs();
+
+    // All deques must exist before any worker starts stealing.
     for (size_t i = 0; i < threads; i++) {
-        workers.emplace_back([this] {
-    while (true) {
-        std::function<void()> task;
-        {
-            std::unique_lock<std::mutex> lock(this->queueMutex);
-            this->condition.wait(lock, [this] {
-                return this->stop || !this->tasks.empty();
-            });
-
-            if (this->stop && this->tasks.empty()) {
-                return;
-            }
-
-            task = std::move(this->tasks.front());
-            this->tasks.pop();
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->rng = 0x9E3779B97F4A7C15ull * (i + 1);
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        workers[i]->thread = std::thread([this, i] { workerLoop(i); });
+    }
+}
+
+void ThreadPool::pinWorker(const size_t index)
+{
+    if (settings.affinity.empty()) return;
+    const int core = settings.affinity[index % settings.affinity.size()];
+
+#if defined(__linux__)
+    // The worker keeps running unpinned, the mismatch is only reported.
+    int error = EINVAL;
+    if (core >= 0 && core < CPU_SETSIZE) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    if (error != 0) {
+        std::cerr << "ThreadPool: can't pin worker " << index << " to core " << core << ": "
+                  << std::strerror(error) << "\n";
+    }
+#else
+    // No hard affinity on this platform (macOS only offers scheduling hints).
+    (void)core;
+#endif
+}
+
+void ThreadPool::submit(InlineTask&& task)
+{
+    activeTasks.fetch_add(1, std::memory_order_relaxed);
+
+    if (currentPool == this) {
+        // Own deque full: run it right here rather than block the worker.
+        if (!workers[currentWorker]->deque.push(std::move(task))) {
+            runTask(task);
+            return;
+        }
+    } else {
+        while (!injection.push(std::move(task))) {
+            std::this_thread::yield();
         }
+    }
+
+    notifyWork();
+}
 
-        task();
+void ThreadPool::notifyWork()
+{
+    epoch.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_seq_cst) > 0) {
+        // Taking the lock orders us after a worker that is about to wait.
+        { std::lock_guard<std::mutex> lock(parkMutex); }
+        parkCondition.notify_one();
+    }
+}
 
-        bool notify = false;
-        {
-            std::unique_lock<std::mutex> lock(this->queueMutex);
-            this->activeTasks--;
+bool ThreadPool::tryAcquire(const size_t index, InlineTask& out)
+{
+    Worker& self = *workers[index];
+    if (self.deque.pop(out)) return true;
+    if (injection.pop(out)) return true;
 
-            if (this->activeTasks == 0) {
-                notify = true;
-            }
+    const size_t count = workers.size();
+    const size_t start = nextRandom(self.rng) % count;
+    for (size_t i = 0; i < count; i++) {
+        const size_t victim = (start + i) % count;
+        if (victim != index && workers[victim]->deque.steal(out)) {
+            self.steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
         }
+    }
+    return false;
+}
 
-        if (notify) {
-            this->finishedCondition.notify_all();
+bool ThreadPool::runPendingTask()
+{
+    InlineTask task;
+    bool found = false;
+
+    if (currentPool == this) {
+        found = tryAcquire(currentWorker, task);
+    } else if (!(found = injection.pop(task))) {
+        thread_local std::uint64_t rng = 0x2545F4914F6CDD1Dull;
+        const size_t count = workers.size();
+        const size_t start = nextRandom(rng) % count;
+        for (size_t i = 0; i < count && !found; i++) {
+            found = workers[(start + i) % count]->deque.steal(task);
         }
     }
-});
+
+    if (found) runTask(task);
+    return found;
+}
+
+void ThreadPool::runTask(InlineTask& task)
+{
+    task();
+    task.reset();
+
+    if (currentPool == this) {
+        workers[currentWorker]->tasks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (activeTasks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        finishedCondition.notify_all();
     }
 }
 
-void ThreadPool::enqueue(std::function<void()> task)
+// Spins for spinBeforePark, then parks until something is enqueued.
+// Returns false once the pool is stopping and no work is left.
+bool ThreadPool::waitForTask(const size_t index, InlineTask& out)
 {
-    {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        tasks.push(std::move(task));
-        activeTasks.fetch_add(1, std::memory_order_relaxed);
+    Worker& self = *workers[index];
+
+    const auto spinUntil = Clock::now() + settings.spinBeforePark;
+    while (Clock::now() < spinUntil) {
+        std::this_thread::yield();
+        if (tryAcquire(index, out)) return true;
+    }
+
+    while (true) {
+        const std::uint64_t seen = epoch.load(std::memory_order_seq_cst);
+        if (tryAcquire(index, out)) return true;
+        if (stop.load(std::memory_order_acquire)) return false;
+
+        self.parks.fetch_add(1, std::memory_order_relaxed);
+        std::unique_lock<std::mutex> lock(parkMutex);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        parkCondition.wait(lock, [this, seen] {
+            return stop.load(std::memory_order_acquire) || epoch.load(std::memory_order_seq_cst) != seen;
+        });
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void ThreadPool::workerLoop(const size_t index)
+{
+    currentPool = this;
+    currentWorker = index;
+    pinWorker(index);
+
+    Worker& self = *workers[index];
+    InlineTask task;
+    while (true) {
+        if (tryAcquire(index, task)) {
+            runTask(task);
+            continue;
+        }
+
+        // Only the idle periods are timed, so busy workers never read the clock.
+        const std::int64_t idleStart = nowNs();
+        const bool found = waitForTask(index, task);
+        self.idleNs.fetch_add(nowNs() - idleStart, std::memory_order_relaxed);
+
+        if (!found) return;
+        runTask(task);
     }
+}
+
+std::vector<ThreadPool::WorkerStats> ThreadPool::workerStats() const
+{
+    const double wallMs = (nowNs() - statsStartNs.load(std::memory_order_relaxed)) / 1e6;
 
-    condition.notify_one();
+    std::vector<WorkerStats> stats;
+    stats.reserve(workers.size());
+    for (const auto& worker : workers) {
+        WorkerStats s;
+        s.tasks = worker->tasks.load(std::memory_order_relaxed);
+        s.steals = worker->steals.load(std::memory_order_relaxed);
+        s.parks = worker->parks.load(std::memory_order_relaxed);
+        const double idleMs = worker->idleNs.load(std::memory_order_relaxed) / 1e6;
+        s.busyMs = std::clamp(wallMs - idleMs, 0.0, wallMs);
+        s.utilization = wallMs > 0.0 ? s.busyMs / wallMs : 0.0;
+        stats.push_back(s);
+    }
+    return stats;
+}
+
+void ThreadPool::resetStats()
+{
+    for (const auto& worker : workers) {
+        worker->tasks.store(0, std::memory_order_relaxed);
+        worker->steals.store(0, std::memory_order_relaxed);
+        worker->parks.store(0, std::memory_order_relaxed);
+        worker->idleNs.store(0, std::memory_order_relaxed);
+    }
+    statsStartNs.store(nowNs(), std::memory_order_relaxed);
 }
 
 void ThreadPool::waitFinished()
 {
-    std::unique_lock<std::mutex> lock(queueMutex);
+    std::unique_lock<std::mutex> lock(finishedMutex);
 
     finishedCondition.wait(lock, [this]() {
-        return tasks.empty() && (activeTasks == 0);
+        return activeTasks.load(std::memory_order_acquire) == 0;
     });
 }
 
 ThreadPool::~ThreadPool()
 {
     {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        stop = true;
+        std::lock_guard<std::mutex> lock(parkMutex);
+        stop.store(true, std::memory_order_release);
     }
-    condition.notify_all();
+    parkCondition.notify_all();
 
-    for(std::thread &worker: workers) {
-        worker.join();
+    for (const auto& worker : workers) {
+        worker->thread.join();
     }
-}
\ No newline at end of file
+}
@@ -1,49 +1,158 @@
 #ifndef RENDERER_THREADPOOL_H
 #define RENDERER_THREADPOOL_H
 
+#include "InlineTask.h"
+#include "MpmcQueue.h"
+#include "WorkStealingDeque.h"
+
 #include <vector>
 #include <thread>
-#include <queue>
-#include <functional>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+/**
+ * Pool configuration. Every field can be overridden from the environment:
+ *
+ *  RENDERER_THREADS    worker count.
+ *  RENDERER_AFFINITY   cores to pin workers to, as a cpu list ("0-7,16-23")
+ *                      or a hex mask ("0xff00"). Worker i gets the i-th
+ *                      allowed core (wrapping around).
+ *  RENDERER_SPIN_US    how long an idle worker keeps looking for work
+ *                      before it parks, in microseconds.
+ */
+struct ThreadPoolConfig {
+    size_t threads = 0;                                  // 0 = hardware_concurrency().
+    std::vector<int> affinity;                           // empty = no pinning.
+    std::chrono::microseconds spinBeforePark{50};
+
+    // Returns 'base' with every variable that is set in the environment applied.
+    static ThreadPoolConfig fromEnvironment(ThreadPoolConfig base);
 
+    // Parses "0-3,8" or "0xf0" into a list of core ids, empty on a malformed string
+    // or a core id of MAX_CORES or above (a mask wider than 64 bits counts as malformed).
+    static std::vector<int> parseAffinity(const char* text);
 
+    static constexpr int MAX_CORES = 1024;                // CPU_SETSIZE on Linux.
+};
+
+/**
+ * Work-stealing pool. Every worker owns a Chase-Lev deque: tasks enqueued
+ * from a worker go to its own deque (no shared lock, LIFO for cache reuse),
+ * tasks enqueued from outside go through a lock-free injection queue.
+ * Idle workers steal from a random victim before parking.
+ *
+ * Tasks are stored inline (InlineTask), enqueue never allocates.
+ */
 class ThreadPool {
 public:
-    static ThreadPool& instance() {
-        static ThreadPool pool(std::thread::hardware_concurrency());
-        return pool;
-    }
+    struct WorkerStats {
+        std::uint64_t tasks = 0;
+        std::uint64_t steals = 0;
+        std::uint64_t parks = 0;
+        double busyMs = 0.0;
+        double utilization = 0.0;                        // busy / wall time since resetStats().
+    };
+
+    /**
+     * @brief The shared pool, created on first use from the configuration
+     *        given to configure() (if any) plus the environment overrides.
+     */
+    static ThreadPool& instance();
+
+    /**
+     * @brief Sets the configuration of the shared pool.
+     *
+     * @param config                                   pool configuration.
+     * @return           false if the shared pool already exists (no effect).
+     */
+    static bool configure(const ThreadPoolConfig& config);
+
+    explicit ThreadPool(size_t threads);
+    explicit ThreadPool(const ThreadPoolConfig& config);
+    ~ThreadPool();
 
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
 
     /**
-     * @brief Enqueue a new task to the queue for the threads to handle.
+     * @brief Enqueue a new task for the workers to handle.
      *
-     * @param task                                   new task to handle.
+     * @param task         callable, captures must fit in InlineTask::CAPACITY.
      */
-    void enqueue(std::function<void()> task);
+    template <typename F>
+    void enqueue(F&& task)
+    {
+        submit(InlineTask(std::forward<F>(task)));
+    }
 
     /**
      * @brief  check and wait for all threads to finish with their work.
+     *         Must not be called from a worker.
      */
     void waitFinished();
 
+    /**
+     * @brief Runs one queued task on the calling thread, if there is any.
+     *        Lets a thread that waits on its own work help instead of blocking.
+     *
+     * @return                             true if a task was executed.
+     */
+    bool runPendingTask();
+
+    [[nodiscard]] size_t size() const { return workers.size(); }
+    [[nodiscard]] const ThreadPoolConfig& config() const { return settings; }
+
+    // Per-worker counters accumulated since construction or the last resetStats().
+    [[nodiscard]] std::vector<WorkerStats> workerStats() const;
+    void resetStats();
+
 private:
-    explicit ThreadPool(size_t threads);
-    ~ThreadPool();
+    static constexpr size_t DEQUE_CAPACITY = 1024;
+    static constexpr size_t INJECTION_CAPACITY = 4096;
+
+    struct Worker {
+        WorkStealingDeque<InlineTask, DEQUE_CAPACITY> deque;
+        std::thread thread;
+        std::uint64_t rng = 0;
+
+        // Written by the owning worker only, read by workerStats().
+        std::atomic<std::uint64_t> tasks = 0;
+        std::atomic<std::uint64_t> steals = 0;
+        std::atomic<std::uint64_t> parks = 0;
+        std::atomic<std::int64_t> idleNs = 0;
+    };
+
+    void submit(InlineTask&& task);
+    void workerLoop(size_t index);
+    bool waitForTask(size_t index, InlineTask& out);
+    bool tryAcquire(size_t index, InlineTask& out);
+    void runTask(InlineTask& task);
+    void notifyWork();
+    void pinWorker(size_t index);
+
+    ThreadPoolConfig settings;
+    std::vector<std::unique_ptr<Worker>> workers;
+    MpmcQueue<InlineTask, INJECTION_CAPACITY> injection;
 
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
+    // Parking: a worker snapshots 'epoch', scans for work and only sleeps if
+    // nothing was enqueued since (enqueue bumps the epoch before waking).
+    std::mutex parkMutex;
+    std::condition_variable parkCondition;
+    std::atomic<std::uint64_t> epoch = 0;
+    std::atomic<int> sleepers = 0;
 
-    std::mutex queueMutex;
-    std::condition_variable condition;
+    std::mutex finishedMutex;
     std::condition_variable finishedCondition;
 
-    bool stop = false;
+    std::atomic<bool> stop = false;
     std::atomic<int> activeTasks = 0;
+    std::atomic<std::int64_t> statsStartNs = 0;
 };
 
 
-#endif //RENDERER_THREADPOOL_H
\ No newline at end of file
+#endif //RENDERER_THREADPOOL_H
@@ -0,0 +1,113 @@
+#ifndef RENDERER_WORKSTEALINGDEQUE_H
+#define RENDERER_WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+
+/**
+ * Fixed capacity Chase-Lev deque (Le, Pop, Cohen, Nardelli - PPoPP'13).
+ * The owning worker pushes and pops at the bottom (LIFO, cache-warm work),
+ * any other thread steals from the top (FIFO, oldest / biggest work).
+ *
+ * Items are stored in place. A slot is only reused once the thread that
+ * took its previous item finished moving it out, which makes reading the
+ * item after winning the race on 'top' safe for non-trivial T.
+ */
+template <typename T, std::size_t Capacity>
+class WorkStealingDeque {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+public:
+    /**
+     * @brief Owner only.
+     * @return false if the deque is full, item is left untouched.
+     */
+    bool push(T&& item)
+    {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed);
+        const std::int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= static_cast<std::int64_t>(Capacity)) return false;
+
+        Slot& slot = slots[b & MASK];
+        while (slot.occupied.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+
+        slot.value = std::move(item);
+        slot.occupied.store(true, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Owner only, takes the most recently pushed item.
+     */
+    bool pop(T& out)
+    {
+        const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_seq_cst);
+        std::int64_t t = top.load(std::memory_order_seq_cst);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (t == b) {
+            // Last item, race the thieves for it.
+            const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                         std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            if (!won) return false;
+        }
+
+        take(slots[b & MASK], out);
+        return true;
+    }
+
+    /**
+     * @brief Any thread, takes the oldest item. May fail spuriously under contention.
+     */
+    bool steal(T& out)
+    {
+        std::int64_t t = top.load(std::memory_order_seq_cst);
+        const std::int64_t b = bottom.load(std::memory_order_seq_cst);
+
+        if (t >= b) return false;
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+
+        take(slots[t & MASK], out);
+        return true;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr std::int64_t MASK = static_cast<std::int64_t>(Capacity) - 1;
+
+    struct Slot {
+        std::atomic<bool> occupied{false};
+        T value;
+    };
+
+    static void take(Slot& slot, T& out)
+    {
+        out = std::move(slot.value);
+        slot.occupied.store(false, std::memory_order_release);
+    }
+
+    alignas(64) std::atomic<std::int64_t> top{0};
+    alignas(64) std::atomic<std::int64_t> bottom{0};
+    alignas(64) Slot slots[Capacity];
+};
+
+#endif //RENDERER_WORKSTEALINGDEQUE_H
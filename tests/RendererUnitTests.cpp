@@ -2,9 +2,53 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <filesystem>
+#include <fstream>
 #include "../Math/Vec.h"
 #include "../Math/Matrix.h"
 #include "../Core/Rasterizer.h"
+#include "../Renderer/ResolutionScaler.h"
+#include "../Utils/TaskGroup.h"
+#include "../Renderer/FrameGraph.h"
+#include "../Renderer/SceneSnapshots.h"
+#include "../Renderer/FrameRing.h"
+#include "../Math/Frustum.h"
+#include "../Renderer/SceneBVH.h"
+#include "../Renderer/LodSelector.h"
+#include "../Core/DepthPyramid.h"
+#include "../Core/TriangleBVH.h"
+#include "../IO/ObjParser.h"
+#include "../IO/MeshCache.h"
+#include "../Core/ResourceLoader.h"
+#include "../Core/ResourceManager.h"
+#include <thread>
+#include <cstring>
+#include <sstream>
+
+// Unit UV sphere, faces wound the same way, written out so it goes through the regular loader.
+static void writeSphereObj(const std::string& path, const int rings, const int segments) {
+    std::ofstream obj(path);
+    obj << "vt 0 0\nvn 0 1 0\n";
+    for (int r = 0; r <= rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            const float theta = static_cast<float>(M_PI) * r / rings;
+            const float phi = 2.0f * static_cast<float>(M_PI) * s / segments;
+            obj << "v " << std::sin(theta) * std::cos(phi) << " " << std::cos(theta) << " "
+                << std::sin(theta) * std::sin(phi) << "\n";
+        }
+    }
+    auto vertex = [segments](const int r, const int s) { return r * segments + s % segments + 1; };
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            const int a = vertex(r, s), b = vertex(r, s + 1), c = vertex(r + 1, s), d = vertex(r + 1, s + 1);
+            obj << "f " << a << "/1/1 " << b << "/1/1 " << c << "/1/1\n";
+            obj << "f " << b << "/1/1 " << d << "/1/1 " << c << "/1/1\n";
+        }
+    }
+}
 
 void RendererUnitTests::runAll() {
     std::cout << "--- Starting Core Math Unit Tests ---" << std::endl;
@@ -16,6 +60,27 @@ void RendererUnitTests::runAll() {
     testCameraMatrices();
     testMatrixShear();
     testBarycentric();
+    testLazyTileClear();
+    testPackedColor();
+    testResolutionScaler();
+    testWorkStealing();
+    testParallelFor();
+    testThreadPoolConfig();
+    testFrameGraph();
+    testSceneSnapshots();
+    testFrameRing();
+    testFrustumCulling();
+    testSceneBVH();
+    testMeshletCulling();
+    testLodSelection();
+    testOcclusionCulling();
+    testInstancedTransforms();
+    testTrianglePicking();
+    testObjParser();
+    testMeshCache();
+    testAsyncLoading();
+    testTgaDecode();
+    testResourceManager();
 
     std::cout << "--- All Unit Tests Passed Successfully! ---" << std::endl;
 }
@@ -128,4 +193,939 @@ void RendererUnitTests::testBarycentric() {
     assert(std::abs(bc.x() - 0.3333f) < 1e-2);
 
     std::cout << "  [OK] Barycentric" << std::endl;
-}
\ No newline at end of file
+}
+
+void RendererUnitTests::testLazyTileClear() {
+    constexpr int w = 40, h = 40; // 2x2 tiles, the right/bottom ones partial.
+    AlignedVector<float> zbuffer(w * h, 7.0f);
+    AlignedVector<std::uint32_t> colorBuffer(w * h, 42);
+    TileClearState state(w, h);
+    const RenderContext ctx = { zbuffer, &colorBuffer, nullptr, w, h, &state };
+
+    assert(reinterpret_cast<std::uintptr_t>(zbuffer.data()) % AlignedMemory::CACHE_LINE_SIZE == 0);
+    assert(reinterpret_cast<std::uintptr_t>(colorBuffer.data()) % AlignedMemory::CACHE_LINE_SIZE == 0);
+
+    state.invalidate();
+    assert(state.needsClear(0) && state.needsClear(3));
+
+    // Tile 0 was rendered this frame, it must survive the resolve.
+    state.markCleared(0);
+    resolveUntouchedTiles(ctx);
+
+    assert(zbuffer[0] == 7.0f && colorBuffer[0] == 42);
+    assert(zbuffer[TILE_SIZE] == DEPTH_CLEAR_VALUE);
+    assert(zbuffer[w * h - 1] == DEPTH_CLEAR_VALUE && colorBuffer[w * h - 1] == 0);
+    for (int i = 0; i < 4; ++i) assert(!state.needsClear(i));
+
+    std::cout << "  [OK] Lazy Tile Clear" << std::endl;
+}
+
+void RendererUnitTests::testPackedColor() {
+    const TGAColor c = {10, 20, 30, 0}; // b, g, r, a
+
+    const std::uint32_t rgba = PackedColor::pack(c, PixelFormat::RGBA8);
+    const std::uint32_t bgra = PackedColor::pack(c, PixelFormat::BGRA8);
+    assert(rgba == 0xFF0A141Eu);
+    assert(bgra == 0xFF1E140Au);
+    assert(PackedColor::channel(bgra, 0, PixelFormat::BGRA8) == 30);
+    assert(PackedColor::channel(rgba, 2, PixelFormat::RGBA8) == 10);
+
+    // Halving keeps alpha and matches per channel integer scaling.
+    const std::uint32_t half = PackedColor::modulate(rgba, PackedColor::MODULATE_ONE / 2);
+    assert(half == 0xFF050A0Fu);
+    assert(PackedColor::modulate(rgba, PackedColor::MODULATE_ONE) == rgba);
+
+    std::cout << "  [OK] Packed Color" << std::endl;
+}
+
+void RendererUnitTests::testResolutionScaler() {
+    ResolutionScaler scaler;
+    scaler.settings.targetFrameMs = 10.0f;
+
+    // Within the budget band nothing changes.
+    scaler.update(10.5f);
+    assert(std::abs(scaler.scale() - 1.0f) < GraphicsUtils::EPSILON);
+
+    // Heavy frames drop the resolution, bounded by minScale.
+    for (int i = 0; i < 100; i++) scaler.update(40.0f);
+    assert(std::abs(scaler.scale() - scaler.settings.minScale) < GraphicsUtils::EPSILON);
+    assert(scaler.scaledSize(800) == 400);
+
+    // Light frames climb back to full resolution.
+    for (int i = 0; i < 100; i++) scaler.update(2.0f);
+    assert(std::abs(scaler.scale() - 1.0f) < GraphicsUtils::EPSILON);
+    assert(scaler.scaledSize(800) == 800);
+
+    std::cout << "  [OK] Resolution Scaler" << std::endl;
+}
+
+void RendererUnitTests::testWorkStealing() {
+    // Owner pops newest first, thieves take the oldest.
+    WorkStealingDeque<int, 8> deque;
+    for (int i = 0; i < 8; i++) assert(deque.push(int(i)));
+    assert(!deque.push(8));
+
+    int value = -1;
+    assert(deque.pop(value) && value == 7);
+    assert(deque.steal(value) && value == 0);
+    while (deque.pop(value)) {}
+    assert(deque.empty() && !deque.steal(value));
+
+    // Nested enqueues land on worker deques and are all accounted for by waitFinished.
+    ThreadPool pool(4);
+    std::atomic<int> counter = 0;
+    for (int i = 0; i < 16; i++) {
+        pool.enqueue([&pool, &counter] {
+            for (int j = 0; j < 100; j++) {
+                pool.enqueue([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+    }
+    pool.waitFinished();
+    assert(counter.load() == 1600);
+
+    std::cout << "  [OK] Work Stealing" << std::endl;
+}
+
+void RendererUnitTests::testParallelFor() {
+    // Every index visited exactly once, chunks never exceed the grain.
+    std::vector<int> visits(1000, 0);
+    parallelFor(0, 1000, 64, [&](const int begin, const int end) {
+        assert(end - begin <= 64);
+        for (int i = begin; i < end; i++) visits[i]++;
+    });
+    assert(std::all_of(visits.begin(), visits.end(), [](const int v) { return v == 1; }));
+
+    // Nested loops and groups inside pool tasks must not deadlock.
+    std::atomic<int> counter = 0;
+    parallelFor(0, 8, 1, [&](const int, const int) {
+        TaskGroup inner;
+        for (int i = 0; i < 4; i++) {
+            inner.run([&counter] {
+                parallelFor(0, 100, 10, [&counter](const int begin, const int end) {
+                    counter.fetch_add(end - begin, std::memory_order_relaxed);
+                });
+            });
+        }
+        inner.wait();
+    });
+    assert(counter.load() == 8 * 4 * 100);
+
+    std::cout << "  [OK] Parallel For" << std::endl;
+}
+
+void RendererUnitTests::testThreadPoolConfig() {
+    assert((ThreadPoolConfig::parseAffinity("0-3,8") == std::vector<int>{0, 1, 2, 3, 8}));
+    assert((ThreadPoolConfig::parseAffinity("0xf0") == std::vector<int>{4, 5, 6, 7}));
+    assert(ThreadPoolConfig::parseAffinity("3-1").empty());
+    assert(ThreadPoolConfig::parseAffinity("cores").empty());
+    assert(ThreadPoolConfig::parseAffinity("0-2000000000").empty());
+    assert(ThreadPoolConfig::parseAffinity("0x1ffffffffffffffff").empty());
+    assert(ThreadPoolConfig::parseAffinity("1023").size() == 1 && ThreadPoolConfig::parseAffinity("1024").empty());
+
+    ThreadPoolConfig config;
+    config.threads = 2;
+    config.spinBeforePark = std::chrono::microseconds(0);
+    ThreadPool pool(config);
+    assert(pool.size() == 2);
+
+    std::atomic<int> counter = 0;
+    for (int i = 0; i < 100; i++) {
+        pool.enqueue([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+    }
+    pool.waitFinished();
+    assert(counter.load() == 100);
+
+    // Tasks run by the workers are all accounted for in the stats.
+    const auto stats = pool.workerStats();
+    assert(stats.size() == 2);
+    std::uint64_t tasks = 0;
+    for (const auto& worker : stats) {
+        assert(worker.utilization >= 0.0 && worker.utilization <= 1.0);
+        tasks += worker.tasks;
+    }
+    assert(tasks == 100);
+
+    pool.resetStats();
+    assert(pool.workerStats()[0].tasks == 0);
+
+    std::cout << "  [OK] Thread Pool Config" << std::endl;
+}
+
+void RendererUnitTests::testFrameGraph() {
+    using namespace FrameResource;
+
+    // Records the order the passes finished in.
+    std::atomic<int> clock = 0;
+    int finished[5] = {};
+    auto pass = [&](const int index) { return [&, index] { finished[index] = clock.fetch_add(1); }; };
+
+    FrameGraph graph;
+    graph.addPass("shadow geometry", None, ShadowGeometry, pass(0));
+    graph.addPass("shadow raster", ShadowGeometry, ShadowMap, pass(1));
+    graph.addPass("color geometry", None, ColorGeometry, pass(2));
+    graph.addPass("color raster", ColorGeometry | ShadowMap, ZBuffer | ColorBuffer, pass(3));
+    graph.addPass("ssao", ZBuffer | ColorBuffer, ColorBuffer, pass(4));
+    graph.execute();
+
+    // Color geometry waits for nothing, the raster only for what it reads.
+    assert(graph.dependenciesOf(2).empty());
+    assert((graph.dependenciesOf(3) == std::vector<int>{1, 2}));
+    assert((graph.dependenciesOf(4) == std::vector<int>{3}));
+
+    assert(finished[0] < finished[1]);
+    assert(finished[1] < finished[3] && finished[2] < finished[3]);
+    assert(finished[3] < finished[4]);
+
+    // Write-after-write orders passes, the redundant a -> c edge is dropped.
+    FrameGraph chain;
+    chain.addPass("a", None, ColorBuffer, [] {});
+    chain.addPass("b", ColorBuffer, ColorBuffer, [] {});
+    chain.addPass("c", None, ColorBuffer, [] {});
+    chain.compile();
+    assert((chain.dependenciesOf(2) == std::vector<int>{1}));
+
+    std::cout << "  [OK] Frame Graph" << std::endl;
+}
+
+void RendererUnitTests::testSceneSnapshots() {
+    Scene front({{0, 1, 6}, {0, 0, 0}, {0, 1, 0}, 3.0f}, Vec3f(0, 1, 0), Vec3f(0, 5, 0));
+    front.addModel(ModelInstance(nullptr, false));
+
+    SceneSnapshots snapshots;
+    assert(!snapshots.latest());
+
+    snapshots.publish(front);
+    SceneSnapshot held = snapshots.latest();
+    assert(snapshots.version() == 1 && held->models.size() == 1);
+
+    // Edits of the front copy never show up in a published snapshot.
+    front.models[0].position = {1, 2, 3};
+    front.addModel(ModelInstance(nullptr, false));
+    assert(held->models.size() == 1 && held->models[0].position.x() == 0.0f);
+
+    snapshots.publish(front);
+    assert(snapshots.latest()->models.size() == 2);
+    assert(snapshots.latest()->models[0].position.x() == 1.0f);
+    assert(held->models.size() == 1);
+
+    // Storage nobody holds anymore is reused instead of allocated.
+    const Scene* heldStorage = held.get();
+    held.reset();
+    snapshots.publish(front);
+    assert(snapshots.latest().get() == heldStorage);
+
+    std::cout << "  [OK] Scene Snapshots" << std::endl;
+}
+
+void RendererUnitTests::testFrameRing() {
+    constexpr int W = 64, H = 48, SHADOW = 64, FRAMES = 6;
+    const auto path = std::filesystem::temp_directory_path() / "renderer_frame_ring_test.obj";
+    writeSphereObj(path.string(), 12, 24);
+    const auto resource = std::make_shared<ModelResource>(ModelLoader(path.string()));
+    std::filesystem::remove(path);
+
+    // A moving camera, and a frame at half resolution so a slot gets resized.
+    // Occlusion culling is off, its occluders depend on which frames came before.
+    std::vector<SceneSnapshot> snapshots;
+    std::vector<std::pair<int, int>> sizes;
+    for (int i = 0; i < FRAMES; ++i) {
+        Scene scene({{0.3f * i, 0.5f, 4}, {0, 0, 0}, {0, 1, 0}, 3.0f}, Vec3f(1, 1, 1).normalize(), {3, 3, 3});
+        scene.useOcclusionCulling = false;
+        scene.addModel(ModelInstance(resource, false));
+        ModelInstance second(resource, false);
+        second.position = {1.2f, 0, -1.0f * i};
+        scene.addModel(second);
+        scene.updateBounds();
+        snapshots.push_back(std::make_shared<const Scene>(std::move(scene)));
+        sizes.emplace_back(i == 3 ? W / 2 : W, i == 3 ? H / 2 : H);
+    }
+
+    // Rendered up front, before the ring's thread shares the renderer.
+    std::vector<std::vector<std::uint32_t>> expected;
+    for (int i = 0; i < FRAMES; ++i) {
+        RenderBuffers reference(sizes[i].first, sizes[i].second, SHADOW, SHADOW);
+        Renderer::render(*snapshots[i], reference);
+        expected.emplace_back(reference.colorBuffer.begin(), reference.colorBuffer.end());
+    }
+
+    // A reused PreparedFrame starts over, its shaders don't pile up.
+    RenderBuffers target(W, H, SHADOW, SHADOW);
+    PreparedFrame reused;
+    Renderer::prepare(*snapshots[0], target, reused);
+    Renderer::prepare(*snapshots[1], target, reused);
+    assert(reused.phongShaders.size() <= snapshots[1]->models.size());
+    assert(reused.depthShaders.size() <= snapshots[1]->models.size());
+
+    // Frame i reports input time i, which tells the frames apart.
+    const auto inputTime = [](const int i) { return FrameRing::Clock::time_point(std::chrono::milliseconds(i + 1)); };
+    const auto waitReady = [](FrameRing& ring) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        const RenderBuffers* frame;
+        while (!(frame = ring.acquireReady())) {
+            assert(std::chrono::steady_clock::now() < deadline);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return frame;
+    };
+
+    for (const auto mode : { FrameRing::PipelineMode::Latency, FrameRing::PipelineMode::Throughput }) {
+        FrameRing ring(W, H, SHADOW, SHADOW, PixelFormat::RGBA8, 3);
+        ring.setPipelineMode(mode);
+
+        // Frames finish in submission order and match a plain render of their snapshot.
+        int presented = 0;
+        const auto present = [&](const RenderBuffers* frame) {
+            assert(frame->stats.inputTime == inputTime(presented));
+            assert(frame->width == sizes[presented].first && frame->height == sizes[presented].second);
+            assert(std::equal(expected[presented].begin(), expected[presented].end(), frame->colorBuffer.begin()));
+            ring.release(frame);
+            presented++;
+        };
+        for (int i = 0; i < FRAMES; ++i) {
+            while (!ring.submit(snapshots[i], sizes[i].first, sizes[i].second, inputTime(i))) {
+                if (const RenderBuffers* frame = ring.acquireReady()) present(frame);
+                std::this_thread::yield();
+            }
+        }
+        while (presented < FRAMES) present(waitReady(ring));
+        assert(!ring.acquireReady());
+
+        // Nothing is submitted while maxFramesInFlight frames wait to be presented.
+        ring.setMaxFramesInFlight(99);
+        assert(ring.getMaxFramesInFlight() == ring.size());
+        ring.setMaxFramesInFlight(1);
+        assert(ring.submit(snapshots[0], W, H));
+        const RenderBuffers* waiting = waitReady(ring);
+        assert(!ring.submit(snapshots[1], W, H));
+        ring.release(waiting);
+        assert(ring.submit(snapshots[1], W, H));
+        ring.release(waitReady(ring));
+    }
+
+    // Shutting down with frames queued drops them and lets go of their snapshots.
+    {
+        FrameRing ring(W, H, SHADOW, SHADOW, PixelFormat::RGBA8, 3);
+        ring.setPipelineMode(FrameRing::PipelineMode::Throughput);
+        ring.submit(snapshots[0], W, H);
+        ring.submit(snapshots[1], W, H);
+    }
+    assert(snapshots[0].use_count() == 1 && snapshots[1].use_count() == 1);
+
+    std::cout << "  [OK] Frame Ring" << std::endl;
+}
+
+void RendererUnitTests::testFrustumCulling() {
+    const Matrix4f4 view = Matrix4f4::lookat({0, 0, 6}, {0, 0, 0}, {0, 1, 0});
+    const Frustum frustum = Frustum::fromMatrix(Matrix4f4::projection(3.0f) * view);
+
+    // In front of the camera, far off to the side, and behind it.
+    assert(frustum.intersectsAABB({-1, -1, -1}, {1, 1, 1}));
+    assert(!frustum.intersectsAABB({99, -1, -1}, {101, 1, 1}));
+    assert(!frustum.intersectsAABB({-1, -1, 10}, {1, 1, 12}));
+
+    assert(frustum.intersectsSphere({0, 0, 0}, 1.0f));
+    assert(!frustum.intersectsSphere({100, 0, 0}, 1.0f));
+    // Straddling the edge of the view is kept.
+    assert(frustum.intersectsSphere({0, 0, 10}, 5.0f));
+
+    std::cout << "  [OK] Frustum Culling" << std::endl;
+}
+
+void RendererUnitTests::testSceneBVH() {
+    // Unit boxes on a 10x10x10 grid, 2 units apart.
+    auto cell = [](const int i, const Vec3f& offset) {
+        AABB box;
+        box.min = Vec3f(i % 10 * 2.0f, i / 10 % 10 * 2.0f, i / 100 * 2.0f) + offset;
+        box.max = box.min + Vec3f(1, 1, 1);
+        return box;
+    };
+    std::vector<AABB> boxes;
+    for (int i = 0; i < 1000; ++i) boxes.push_back(cell(i, {0, 0, 0}));
+
+    SceneBVH bvh;
+    bvh.build(boxes);
+    assert(bvh.size() == 1000 && bvh.nodeCount() < 1000);
+
+    auto bruteForce = [&boxes](const AABB& range) {
+        std::vector<int> hits;
+        for (int i = 0; i < static_cast<int>(boxes.size()); ++i) {
+            bool overlap = true;
+            for (int k = 0; k < 3; ++k) {
+                overlap = overlap && boxes[i].max[k] >= range.min[k] && range.max[k] >= boxes[i].min[k];
+            }
+            if (overlap) hits.push_back(i);
+        }
+        return hits;
+    };
+
+    AABB range;
+    range.min = {3.5f, 3.5f, 3.5f};
+    range.max = {8.5f, 6.5f, 12.5f};
+    std::vector<int> hits;
+    bvh.queryAABB(range, hits);
+    assert(hits == bruteForce(range) && hits.size() == 3 * 2 * 5);
+
+    // Moving a few instances refits, queries follow them.
+    for (int i = 0; i < 1000; i += 97) {
+        boxes[i] = cell(i, {0.5f, 0.5f, 0.5f});
+        bvh.update(i, boxes[i]);
+    }
+    bvh.refit();
+    bvh.queryAABB(range, hits);
+    assert(hits == bruteForce(range));
+
+    // The nearest box along the ray wins, filtered ones are skipped.
+    float t;
+    assert(bvh.raycast({0.75f, 0.75f, -5.0f}, {0, 0, 1}, t) == 0 && std::abs(t - 5.5f) < 1e-4f);
+    assert(bvh.raycast({0.75f, 0.75f, -5.0f}, {0, 0, 1}, t, [](const int i) { return i != 0; }) == 100);
+    assert(bvh.raycast({0.75f, 0.75f, -5.0f}, {0, 0, -1}, t) == -1);
+
+    // Moving all of them far apart makes the tree rebuild, and still match.
+    for (int i = 0; i < 1000; ++i) {
+        boxes[i] = cell(i, {i * 7.0f, 0, 0});
+        bvh.update(i, boxes[i]);
+    }
+    bvh.refit();
+    range.min = {0, 0, 0};
+    range.max = {3000, 30, 30};
+    bvh.queryAABB(range, hits);
+    assert(hits == bruteForce(range));
+
+    std::cout << "  [OK] Scene BVH" << std::endl;
+}
+
+void RendererUnitTests::testMeshletCulling() {
+    const auto path = std::filesystem::temp_directory_path() / "renderer_meshlet_test.obj";
+    writeSphereObj(path.string(), 24, 48);
+    const ModelLoader model(path.string());
+    std::filesystem::remove(path);
+
+    const auto& faces = model.getFaces();
+    const auto& meshlets = model.getMeshlets();
+    assert(faces.size() == 24 * 48 * 2);
+
+    // Meshlets tile the faces in order, their sphere holds every vertex and
+    // their vertex ranges every vertex index, the only ones transformed for them.
+    int next = 0;
+    for (const auto& meshlet : meshlets) {
+        assert(meshlet.firstFace == next && meshlet.faceCount > 0 && meshlet.faceCount <= MESHLET_SIZE);
+        assert(meshlet.vertexRangeCount > 0 && meshlet.vertexRangeCount <= MESHLET_VERTEX_RANGES);
+        for (int r = 1; r < meshlet.vertexRangeCount; ++r) {
+            assert(meshlet.vertexRanges[r - 1].end < meshlet.vertexRanges[r].begin);
+        }
+        next += meshlet.faceCount;
+        for (int f = meshlet.firstFace; f < next; ++f) {
+            for (const auto& p : faces[f].pts) assert((p - meshlet.center).length() <= meshlet.radius + 1e-4f);
+            for (int i = 0; i < 3; ++i) {
+                const int index = faces[f].vertexIndices[i];
+                assert((model.getVertices()[index] - faces[f].pts[i]).length() == 0.0f);
+                assert(std::any_of(meshlet.vertexRanges, meshlet.vertexRanges + meshlet.vertexRangeCount,
+                                   [index](const VertexRange& range) { return index >= range.begin && index < range.end; }));
+            }
+        }
+    }
+    assert(next == static_cast<int>(faces.size()));
+
+    // A culled meshlet never holds a triangle the rasterizer keeps - one that
+    // is at least partly on screen with a positive screen space area.
+    const Matrix4f4 view = Matrix4f4::lookat({0, 0, 6}, {0, 0, 0}, {0, 1, 0});
+    const Matrix4f4 offsets[] = { Matrix4f4::identity(), Matrix4f4::translation({1.5f, 0.5f, 0}),
+                                  Matrix4f4::translation({4, 0, 0}) * Matrix4f4::rotationY(40.0f) };
+    int culled = 0;
+    for (const auto& modelMat : offsets) {
+        const Matrix4f4 clip = Matrix4f4::projection(3.0f) * view * modelMat;
+        const MeshletCuller culler(clip);
+
+        for (const auto& meshlet : meshlets) {
+            if (culler.isVisible(meshlet)) continue;
+            culled++;
+
+            for (int f = meshlet.firstFace; f < meshlet.firstFace + meshlet.faceCount; ++f) {
+                Vec4f v[3];
+                for (int i = 0; i < 3; ++i) v[i] = clip * Vec4f(faces[f].pts[i]);
+
+                bool offScreen = false;
+                for (int axis = 0; axis < 2 && !offScreen; ++axis) {
+                    offScreen = (v[0][axis] > v[0].w() && v[1][axis] > v[1].w() && v[2][axis] > v[2].w()) ||
+                                (v[0][axis] < -v[0].w() && v[1][axis] < -v[1].w() && v[2][axis] < -v[2].w());
+                }
+                if (offScreen) continue;
+
+                const Vec2f a(v[0].x() / v[0].w(), v[0].y() / v[0].w());
+                const Vec2f b(v[1].x() / v[1].w(), v[1].y() / v[1].w());
+                const Vec2f c(v[2].x() / v[2].w(), v[2].y() / v[2].w());
+                assert(determinant2D(b - a, c - a) <= 1e-6f);
+            }
+        }
+    }
+    assert(culled > 0);
+
+    std::cout << "  [OK] Meshlet Culling" << std::endl;
+}
+
+void RendererUnitTests::testLodSelection() {
+    const auto path = std::filesystem::temp_directory_path() / "renderer_lod_test.obj";
+    writeSphereObj(path.string(), 48, 96);
+    const auto resource = std::make_shared<ModelResource>(ModelLoader(path.string()));
+    std::filesystem::remove(path);
+
+    // Each level roughly halves the faces, stays on the sphere and keeps the winding.
+    assert(resource->lodCount() >= 3);
+    for (int level = 1; level < resource->lodCount(); ++level) {
+        const auto& faces = resource->lod(level).getFaces();
+        assert(faces.size() * 10 <= resource->lod(level - 1).getFaces().size() * 6);
+
+        // Only the vertices the level still uses are kept.
+        const ModelLoader& coarse = resource->lod(level);
+        assert(coarse.getVertices().size() < resource->lod(level - 1).getVertices().size());
+        assert(coarse.getVertexStreams().size() == static_cast<int>(coarse.getVertices().size()));
+        std::vector<char> used(coarse.getVertices().size(), 0);
+        for (const auto& face : faces) {
+            for (const int index : face.vertexIndices) used[index] = 1;
+        }
+        assert(std::find(used.begin(), used.end(), 0) == used.end());
+
+        for (const auto& face : faces) {
+            const Vec3f centroid = (face.pts[0] + face.pts[1] + face.pts[2]) / 3.0f;
+            const Vec3f n = cross(face.pts[1] - face.pts[0], face.pts[2] - face.pts[0]);
+            assert(centroid.length() > 0.8f && centroid.length() <= 1.0f);
+            assert(dotProduct(n, centroid) >= -1e-6f);
+        }
+    }
+
+    Scene scene({{0, 0, 6}, {0, 0, 0}, {0, 1, 0}, 3.0f}, Vec3f(0, 1, 0), Vec3f(0, 5, 0));
+    scene.addModel(ModelInstance(resource, false));
+    LodSelector selector;
+
+    auto lodAt = [&](const float z) {
+        scene.models[0].position = {0, 0, z};
+        selector.update(scene, 800);
+        return scene.models[0].lod;
+    };
+    assert(lodAt(0.0f) == 0);
+    assert(lodAt(-300.0f) == resource->lodCount() - 1);
+
+    // Coming closer switches to level 0 later than moving away leaves it.
+    float switchIn = 0.0f, switchOut = 0.0f;
+    for (float z = -300.0f; z <= 0.0f; z += 0.5f) {
+        if (lodAt(z) == 0) { switchIn = z; break; }
+    }
+    for (float z = switchIn; z >= -300.0f; z -= 0.5f) {
+        if (lodAt(z) != 0) { switchOut = z; break; }
+    }
+    assert(switchIn < 0.0f && switchOut < switchIn - 1.0f);
+
+    // Over budget, instances drop to coarser levels until the faces fit.
+    for (int i = 0; i < 20; ++i) scene.addModel(ModelInstance(resource, false));
+    for (auto& model : scene.models) model.position = {0, 0, 0};
+    selector.settings.faceBudget = 20000;
+    selector.update(scene, 800);
+    assert(selector.selectedFaces() <= 20000);
+
+    std::cout << "  [OK] LOD Selection" << std::endl;
+}
+
+void RendererUnitTests::testOcclusionCulling() {
+    constexpr int W = 64, H = 48;
+    const Vec3f eye(0, 0, 6);
+    const Matrix4f4 viewProj = Matrix4f4::projection(6.0f) * Matrix4f4::lookat(eye, {0, 0, 0}, {0, 1, 0});
+
+    // A wall at z = 0 covering the whole frame, with a far hole in the lower left quarter.
+    const Vec4f wall = viewProj * Vec4f(Vec3f(0, 0, 0));
+    AlignedVector<float> zbuffer(W * H, wall.z() / wall.w() * 0.5f + 0.5f);
+    for (int y = 0; y < H / 2; ++y) {
+        for (int x = 0; x < W / 2; ++x) zbuffer[x + y * W] = -std::numeric_limits<float>::max();
+    }
+
+    DepthPyramid pyramid;
+    assert(!pyramid.isOccluded({-1, -1, -3}, {1, 1, -2}, viewProj));
+
+    pyramid.build(zbuffer, W, H, viewProj, eye, {0, 0, -1});
+    assert(pyramid.isValid() && pyramid.levelCount() == 6);
+
+    // Behind the wall, in front of it, crossing the camera, and behind the hole.
+    assert(pyramid.isOccluded({0.2f, -0.5f, -3}, {0.5f, -0.2f, -2}, viewProj));
+    assert(!pyramid.isOccluded({0.2f, -0.5f, 1}, {0.5f, -0.2f, 2}, viewProj));
+    assert(!pyramid.isOccluded({-1, -1, 5}, {1, 1, 7}, viewProj));
+    assert(!pyramid.isOccluded({-0.5f, -0.5f, -3}, {-0.2f, -0.2f, -2}, viewProj));
+
+    // A model matrix moves the box space, here out of the wall's shadow.
+    const Matrix4f4 toClip = viewProj * Matrix4f4::translation(Vec3f(0, 0, 3));
+    assert(!pyramid.isOccluded({0.2f, -0.5f, -3}, {0.5f, -0.2f, -2}, toClip));
+
+    pyramid.invalidate();
+    assert(!pyramid.isOccluded({0.2f, -0.5f, -3}, {0.5f, -0.2f, -2}, viewProj));
+
+    std::cout << "  [OK] Occlusion Culling" << std::endl;
+}
+
+void RendererUnitTests::testInstancedTransforms() {
+    VertexStreams streams;
+    std::vector<Vec3f> points;
+    for (int i = 0; i < 37; ++i) {
+        const Vec3f p(std::sin(i * 1.3f), std::cos(i * 0.7f) * 2.0f, i * 0.25f - 4.0f);
+        points.push_back(p);
+        streams.x.push_back(p.x());
+        streams.y.push_back(p.y());
+        streams.z.push_back(p.z());
+    }
+
+    const Matrix4f4 clip = Matrix4f4::projection(3.0f) * Matrix4f4::lookat({1, 2, 6}, {0, 0, 0}, {0, 1, 0}) *
+                           Matrix4f4::rotationY(30.0f) * Matrix4f4::scale(2, 1, 0.5f);
+
+    // Two batches, both must match the per-vertex transform bit for bit.
+    ClipPositions out;
+    out.x.resize(streams.size());
+    out.y.resize(streams.size());
+    out.z.resize(streams.size());
+    out.w.resize(streams.size());
+    transformVertices(streams, clip, out, 0, 20);
+    transformVertices(streams, clip, out, 20, streams.size());
+
+    for (int i = 0; i < streams.size(); ++i) {
+        const Vec4f expected = clip * Vec4f(points[i]);
+        const Vec4f actual = out.at(i);
+        for (int k = 0; k < 4; ++k) assert(actual[k] == expected[k]);
+    }
+
+    // The cached model matrix follows the instance after an edit, with or without an update.
+    ModelInstance instance(nullptr, false);
+    instance.position = {1, 2, 3};
+    instance.rotation = {10, 20, 30};
+    const Matrix4f4 before = instance.getModelMatrix();
+    instance.updateTransform();
+    assert(instance.getModelMatrix()[3][0] == before[3][0]);
+
+    instance.position = {4, 2, 3};
+    assert(instance.getModelMatrix()[3][0] == 4.0f);
+    instance.updateTransform();
+    assert(instance.getModelMatrix()[3][0] == 4.0f);
+    assert(instance.getModelMatrix()[1][2] == before[1][2]);
+
+    std::cout << "  [OK] Instanced Transforms" << std::endl;
+}
+
+void RendererUnitTests::testTrianglePicking() {
+    const auto path = std::filesystem::temp_directory_path() / "renderer_test_picking.obj";
+    writeSphereObj(path.string(), 24, 48);
+    const auto resource = std::make_shared<ModelResource>(ModelLoader(path.string()));
+    std::filesystem::remove(path);
+
+    const TriangleBVH& bvh = resource->triangleBVH();
+    assert(bvh.size() == 24 * 48 * 2 && bvh.nodeCount() < bvh.size());
+
+    // The unit sphere is tessellated inside its radius, so hits are slightly beyond it.
+    TriangleBVH::Hit hit;
+    assert(bvh.raycast({0, 0, -5}, {0, 0, 1}, hit));
+    assert(hit.t > 3.99f && hit.t < 4.05f && hit.face >= 0);
+    assert(hit.u >= 0.0f && hit.v >= 0.0f && hit.u + hit.v <= 1.0f);
+
+    // The hit point is on the reported face.
+    const Face& face = resource->model.getFaces()[hit.face];
+    const Vec3f onFace = face.pts[0] * (1.0f - hit.u - hit.v) + face.pts[1] * hit.u + face.pts[2] * hit.v;
+    assert(std::abs(onFace.z() + 5.0f - hit.t) < 1e-4f);
+
+    // Farther than the best hit so far, and a miss next to the sphere.
+    TriangleBVH::Hit closer;
+    closer.t = 3.0f;
+    assert(!bvh.raycast({0, 0, -5}, {0, 0, 1}, closer) && closer.face == -1);
+    TriangleBVH::Hit miss;
+    assert(!bvh.raycast({0.9f, 0.9f, -5}, {0, 0, 1}, miss));
+
+    // Instances share the tree, the ray is brought into model space and distances stay in world units.
+    ModelInstance scaled(resource, false);
+    scaled.position = {0, 0, 10};
+    scaled.scale = {2, 2, 2};
+    TriangleBVH::Hit world;
+    assert(scaled.raycast({0, 0, 0}, {0, 0, 1}, world));
+    assert(world.t > 7.95f && world.t < 8.02f);
+
+    // The ray passes through the corner of the first sphere's box but misses the sphere,
+    // picking by boxes would return it instead of the sphere behind.
+    Scene scene({{0, 0, 6}, {0, 0, 0}, {0, 1, 0}, 3.0f}, {0, 0, 1}, {1, 1, 1});
+    scene.addModel(ModelInstance(resource, false));
+    ModelInstance behind(resource, false);
+    behind.position = {0.9f, 0.9f, 5};
+    scene.addModel(behind);
+    scene.updateBounds();
+
+    float boxT;
+    assert(scene.bvh.raycast({0.9f, 0.9f, -5}, {0, 0, 1}, boxT) == 0);
+    const RayHit picked = scene.raycast({0.9f, 0.9f, -5}, {0, 0, 1});
+    assert(picked.instance == 1 && picked.face.t > 8.9f && picked.face.t < 9.05f);
+
+    assert(scene.raycast({0.9f, 0.9f, -5}, {0, 0, 1}, [](const int i) { return i != 1; }).instance == -1);
+
+    std::cout << "  [OK] Triangle Picking" << std::endl;
+}
+
+void RendererUnitTests::testObjParser() {
+    // Every corner form, a relative quad, a pentagon, comments and CRLF line ends.
+    const std::string text =
+        "# comment\r\n"
+        "o shape\n"
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv -0.5 0.5 +1e-1\n"
+        "vt 0 0\nvt 1 0\nvt 1 1\n"
+        "vn 0 0 1\r\n"
+        "f 1 2 3\n"
+        "f 1/1 2/2 3/3\n"
+        "f 1//1 2//1 3//1\n"
+        "f 1/1/1 2/2/1 3/3/1 # trailing\n"
+        "f -5 -4 -3 -2\n"
+        "f 1 2 3 4 5\n"
+        "f 1 2 9\n";
+
+    ObjMesh mesh;
+    parseObjText(text, mesh);
+    assert(mesh.vertices.size() == 5 && mesh.textures.size() == 3 && mesh.normals.size() == 1);
+    assert(std::abs(mesh.vertices[4].z() - 0.1f) < 1e-6f);
+
+    // 4 triangles, 2 from the quad, 3 from the pentagon, the out of range face dropped.
+    assert(mesh.faces.size() == 9);
+    assert(mesh.faces[0].textureIndices[0] == -1 && mesh.faces[0].normalIndices[0] == -1);
+    assert(mesh.faces[1].textureIndices[2] == 2 && mesh.faces[1].normalIndices[2] == -1);
+    assert(mesh.faces[2].textureIndices[1] == -1 && mesh.faces[2].normalIndices[1] == 0);
+    assert(mesh.faces[3].textureIndices[1] == 1 && mesh.faces[3].normalIndices[1] == 0);
+    assert(mesh.faces[4].vertexIndices[0] == 0 && mesh.faces[5].vertexIndices[2] == 3);
+    assert(mesh.faces[8].vertexIndices[0] == 0 && mesh.faces[8].vertexIndices[2] == 4);
+
+    // Missing normals fall back to the face normal.
+    mesh.faces[0].updateFace(mesh.vertices, mesh.normals, mesh.textures);
+    assert(mesh.faces[0].normals[0].z() == 1.0f);
+
+    // Large enough for several chunks, relative indices must resolve across them.
+    std::ostringstream big;
+    constexpr int TRIANGLES = 60000;
+    for (int i = 0; i < TRIANGLES; ++i) {
+        big << "v " << i << " 0 0\nv " << i << " 1 0\nv " << i << " 0 1\nf -3 -2 -1\n";
+    }
+    parseObjText(big.str(), mesh);
+    assert(big.str().size() > 2 << 20);
+    assert(mesh.vertices.size() == 3 * TRIANGLES && mesh.faces.size() == TRIANGLES);
+    for (int i = 0; i < TRIANGLES; ++i) {
+        const int first = mesh.faces[i].vertexIndices[0];
+        assert(first == 3 * i && mesh.faces[i].vertexIndices[2] == first + 2);
+        assert(mesh.vertices[first].x() == static_cast<float>(i));
+    }
+
+    // Parsed on another pool, as the resource loader does - the shared pool runs none of the chunks.
+    ThreadPool loaderPool(2);
+    ThreadPool::instance().resetStats();
+    ObjMesh loaded;
+    parseObjText(big.str(), loaded, loaderPool);
+    assert(loaded.faces.size() == TRIANGLES);
+    for (const auto& stats : ThreadPool::instance().workerStats()) assert(stats.tasks == 0);
+
+    std::cout << "  [OK] OBJ Parser" << std::endl;
+}
+
+void RendererUnitTests::testMeshCache() {
+    const auto path = std::filesystem::temp_directory_path() / "renderer_cache_test.obj";
+    const std::string source = path.string();
+    writeSphereObj(source, 16, 32);
+    std::filesystem::remove(meshCachePath(source));
+
+    MeshCacheData built;
+    assert(!readMeshCache(source, built));
+    built.levels.emplace_back(source);
+    built.levels.push_back(simplifyMesh(built.levels.front(), 300));
+    built.boundsMin = Vec3f(-1, -1, -1);
+    built.boundsMax = Vec3f(1, 1, 1);
+    assert(writeMeshCache(source, built));
+
+    // Faces are stored as indices only, far smaller than the filled in faces.
+    size_t builtFaces = 0;
+    for (const auto& level : built.levels) builtFaces += level.getFaces().size();
+    assert(std::filesystem::file_size(meshCachePath(source)) < builtFaces * sizeof(Face));
+
+    // The cached arrays are the built ones byte for byte - faces and tangents
+    // rebuilt from the stored indices, the rest read in place from the mapping.
+    auto sameBytes = [](const auto a, const auto b) {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size_bytes()) == 0;
+    };
+    MeshCacheData cached;
+    assert(readMeshCache(source, cached));
+    assert(cached.levels.size() == 2 && cached.boundsMax.y() == 1.0f);
+    for (size_t level = 0; level < cached.levels.size(); ++level) {
+        const ModelLoader& a = built.levels[level];
+        const ModelLoader& b = cached.levels[level];
+        assert(b.getFaces().data() != a.getFaces().data());
+        assert(sameBytes(a.getFaces(), b.getFaces()) && sameBytes(a.getMeshlets(), b.getMeshlets()));
+        assert(sameBytes(a.getTangents(), b.getTangents()) && sameBytes(a.getVertices(), b.getVertices()));
+        assert(b.getVertexStreams().size() == static_cast<int>(a.getVertices().size()));
+    }
+
+    // A touched but unchanged source is recognized by its hash, an edited one is not.
+    std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::hours(1));
+    assert(readMeshCache(source, cached));
+    std::ofstream(source, std::ios::app) << "# edited\n";
+    assert(!readMeshCache(source, cached));
+    assert(cached.levels.size() == 2);
+
+    std::filesystem::remove(meshCachePath(source));
+    std::filesystem::remove(path);
+
+    std::cout << "  [OK] Mesh Cache" << std::endl;
+}
+
+void RendererUnitTests::testAsyncLoading() {
+    const auto folder = std::filesystem::temp_directory_path();
+    const std::string root = folder.string() + "/";
+    writeSphereObj(root + "renderer_async_test.obj", 8, 16);
+    TGAImage texture(4, 2, TGAImage::RGB);
+    texture.set(1, 0, {10, 20, 30, 255});
+    assert(texture.write_tga_file(root + "renderer_async_test.tga"));
+
+    // The placeholder is a closed cube, every face wound outwards.
+    const auto placeholder = ResourceLoader::placeholder();
+    assert(placeholder == ResourceLoader::placeholder());
+    assert(placeholder->model.getFaces().size() == 12);
+    for (const auto& face : placeholder->model.getFaces()) {
+        const Vec3f centroid = (face.pts[0] + face.pts[1] + face.pts[2]) / 3.0f;
+        assert(dotProduct(cross(face.pts[1] - face.pts[0], face.pts[2] - face.pts[0]), centroid) > 0.0f);
+    }
+
+    std::vector<ResourceLoader::Loaded> loaded;
+    {
+        ResourceManager assets;
+        ResourceLoader loader(assets, 2);
+        const auto load = [&] {
+            return loader.load(root, "renderer_async_test.obj", "renderer_async_test.tga",
+                               "renderer_async_test.tga", "renderer_async_test.tga");
+        };
+        const ResourceLoader::Ticket ticket = load();
+        assert(load() == ticket && loader.pending() == 1);
+
+        for (int i = 0; i < 1000 && loaded.empty(); ++i) {
+            loaded = loader.poll();
+            if (loaded.empty()) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        assert(loaded.size() == 1 && loaded[0].ticket == ticket && loader.pending() == 0);
+        assert(load() != ticket);
+    }
+
+    // Same resource as a synchronous load, textures flipped the same way.
+    const ModelResource reference(root, "renderer_async_test.obj", "renderer_async_test.tga",
+                                  "renderer_async_test.tga", "renderer_async_test.tga");
+    const ModelResource& resource = *loaded[0].resource;
+    assert(resource.model.getFaces().size() == reference.model.getFaces().size());
+    assert(resource.lodCount() == reference.lodCount());
+    assert(resource.specular->width() == 4 && resource.specular->height() == 2);
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 4; ++x) assert(resource.normal->get(x, y)[0] == reference.normal->get(x, y)[0]);
+    }
+    assert(resource.diffuse->get(1, 0)[0] == 10);
+
+    for (const char* file : { "renderer_async_test.obj", "renderer_async_test.obj.meshcache", "renderer_async_test.tga" }) {
+        std::filesystem::remove(root + file);
+    }
+
+    std::cout << "  [OK] Async Loading" << std::endl;
+}
+
+void RendererUnitTests::testTgaDecode() {
+    // Runs of equal pixels next to noisy ones, so RLE packets of both kinds cross the row ends.
+    TGAImage image(7, 5, TGAImage::RGBA);
+    for (int y = 0; y < 5; ++y) {
+        for (int x = 0; x < 7; ++x) {
+            const auto value = static_cast<std::uint8_t>(y == 2 || x < 3 ? 40 : x * 31 + y * 7);
+            image.set(x, y, {value, static_cast<std::uint8_t>(value + 1), static_cast<std::uint8_t>(y), 200});
+        }
+    }
+
+    const std::string path = (std::filesystem::temp_directory_path() / "renderer_tga_test.tga").string();
+    const auto samePixels = [](const TGAImage& a, const TGAImage& b, const bool flipped) {
+        for (int y = 0; y < a.height(); ++y) {
+            for (int x = 0; x < a.width(); ++x) {
+                const TGAColor ca = a.get(x, y), cb = b.get(x, flipped ? b.height() - 1 - y : y);
+                for (int c = 0; c < 4; ++c) if (ca.bgra[c] != cb.bgra[c]) return false;
+            }
+        }
+        return true;
+    };
+
+    // vflip on write marks the rows as bottom-up, reading them back with vflip restores the memory order.
+    for (const bool rle : { true, false }) {
+        for (const bool bottomUp : { true, false }) {
+            assert(image.write_tga_file(path, bottomUp, rle));
+            TGAImage topDown, flipped;
+            assert(topDown.read_tga_file(path) && flipped.read_tga_file(path, true));
+            assert(topDown.width() == 7 && topDown.height() == 5 && flipped.width() == 7);
+            assert(samePixels(image, topDown, bottomUp));
+            assert(samePixels(image, flipped, !bottomUp));
+
+            topDown.flip_vertically();
+            assert(samePixels(topDown, flipped, false));
+        }
+    }
+
+    // A file cut short inside the pixel data is rejected.
+    assert(image.write_tga_file(path, true, true));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 40);
+    TGAImage truncated(3, 3, TGAImage::RGB);
+    assert(!truncated.read_tga_file(path));
+    assert(truncated.width() == 0 && truncated.height() == 0 && truncated.buffer_size() == 0);
+
+    std::filesystem::remove(path);
+    std::cout << "  [OK] TGA Decode" << std::endl;
+}
+
+void RendererUnitTests::testResourceManager() {
+    const std::string root = std::filesystem::temp_directory_path().string() + "/";
+    writeSphereObj(root + "renderer_assets_a.obj", 8, 16);
+    std::filesystem::copy_file(root + "renderer_assets_a.obj", root + "renderer_assets_b.obj",
+                               std::filesystem::copy_options::overwrite_existing);
+    TGAImage texture(16, 16, TGAImage::RGB);
+    texture.set(3, 3, {1, 2, 3, 255});
+    assert(texture.write_tga_file(root + "renderer_assets_a.tga") && texture.write_tga_file(root + "renderer_assets_b.tga"));
+    texture.set(4, 4, {4, 5, 6, 255});
+    assert(texture.write_tga_file(root + "renderer_assets_c.tga"));
+
+    ResourceManager assets;
+    const auto makeResource = [&](const char* obj, const char* tga) {
+        const auto map = assets.loadTexture(root + tga);
+        return std::make_shared<ModelResource>(assets.loadMesh(root + obj), map, map, map);
+    };
+
+    // Same content under another name is the same asset, different content is not.
+    auto first = makeResource("renderer_assets_a.obj", "renderer_assets_a.tga");
+    auto second = makeResource("renderer_assets_b.obj", "renderer_assets_b.tga");
+    auto third = makeResource("renderer_assets_a.obj", "renderer_assets_c.tga");
+    assert(first->mesh == second->mesh && first->mesh == third->mesh && &first->model == &second->model);
+    assert(first->diffuse == second->diffuse && first->diffuse != third->diffuse);
+
+    const auto report = assets.report();
+    assert(report.size() == 3);
+    const size_t textureBytes = 16 * 16 * 3;
+    const size_t meshBytes = assets.residentBytes() - 2 * textureBytes;
+    assert(meshBytes > first->model.getFaces().size_bytes());
+    for (const auto& asset : report) assert(asset.bytes == (asset.isTexture ? textureBytes : meshBytes));
+
+    // Over the budget, only unused resources go, the least recently used first.
+    assets.add("a", first);
+    assets.add("b", second);
+    assets.add("c", third);
+    assets.budget = 0;
+    assert(assets.trim() == 0 && assets.resourceCount() == 3);
+
+    first.reset();
+    second.reset();
+    third.reset();
+    assert(assets.find("a") != nullptr);
+    assets.budget = meshBytes + textureBytes;
+    assert(assets.trim() == 2 && assets.resourceCount() == 1);
+    assert(assets.find("b") == nullptr && assets.find("c") == nullptr && assets.find("a") != nullptr);
+    assert(assets.residentBytes() == meshBytes + textureBytes && assets.report().size() == 2);
+
+    assets.budget = 0;
+    assert(assets.trim() == 1 && assets.residentBytes() == 0 && assets.report().empty());
+
+    for (const char* file : { "renderer_assets_a.obj", "renderer_assets_a.obj.meshcache", "renderer_assets_b.obj",
+                              "renderer_assets_b.obj.meshcache", "renderer_assets_a.tga", "renderer_assets_b.tga",
+                              "renderer_assets_c.tga" }) {
+        std::filesystem::remove(root + file);
+    }
+
+    std::cout << "  [OK] Resource Manager" << std::endl;
+}
@@ -14,6 +14,27 @@ private:
     static void testCameraMatrices(); // Perspective + LookAt
     static void testMatrixShear();
     static void testBarycentric();
+    static void testLazyTileClear();
+    static void testPackedColor();
+    static void testResolutionScaler();
+    static void testWorkStealing();
+    static void testParallelFor();
+    static void testThreadPoolConfig();
+    static void testFrameGraph();
+    static void testSceneSnapshots();
+    static void testFrameRing();
+    static void testFrustumCulling();
+    static void testSceneBVH();
+    static void testMeshletCulling();
+    static void testLodSelection();
+    static void testOcclusionCulling();
+    static void testInstancedTransforms();
+    static void testTrianglePicking();
+    static void testObjParser();
+    static void testMeshCache();
+    static void testAsyncLoading();
+    static void testTgaDecode();
+    static void testResourceManager();
 };
 
 #endif
\ No newline at end of file